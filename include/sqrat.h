@@ -32,9 +32,27 @@
 #include "sqrat/sqratTable.h"
 #include "sqrat/sqratClass.h"
 #include "sqrat/sqratFunction.h"
+#include "sqrat/sqratPreparedCall.h"
+#include "sqrat/sqratDelegate.h"
+#include "sqrat/sqratCallback.h"
+#include "sqrat/sqratThread.h"
+#include "sqrat/sqratCoroutine.h"
+#include "sqrat/sqratScheduler.h"
+#include "sqrat/sqratBudget.h"
+#include "sqrat/sqratCompileBatch.h"
+#include "sqrat/sqratModuleCache.h"
+#include "sqrat/sqratVMPool.h"
+#include "sqrat/sqratBindingPlan.h"
+#include "sqrat/sqratLazyClass.h"
+#include "sqrat/sqratWorkerPool.h"
+#include "sqrat/sqratParallelMap.h"
+#include "sqrat/sqratSerialize.h"
+#include "sqrat/sqratChannel.h"
 #include "sqrat/sqratConst.h"
 #include "sqrat/sqratUtil.h"
 #include "sqrat/sqratScript.h"
 #include "sqrat/sqratArray.h"
+#include "sqrat/sqratStdContainers.h"
+#include "sqrat/sqratContainerViews.h"
 
 #endif
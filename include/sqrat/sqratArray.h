@@ -38,6 +38,96 @@
 
 namespace Sqrat {
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Bulk conversion between Squirrel arrays and C arrays of arithmetic type
+///
+/// \remarks
+/// Elements are read with sq_direct_get, so the VM stack is not touched while reading. Elements are gathered in chunks;
+/// a chunk made only of integers or only of floats is converted with a plain loop that the compiler can vectorize,
+/// any other chunk is converted element by element.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+struct BulkNumeric
+{
+    static_assert(SQRAT_STD::is_arithmetic<T>::value && !SQRAT_STD::is_same<T, bool>::value,
+                  "bulk array conversion requires an integer or floating point element type");
+
+    enum { CHUNK_SIZE = 64 };
+
+    /// Reads count elements starting at index start of the array arr into dest, returns the amount of elements read
+    static SQInteger Read(HSQUIRRELVM vm, const HSQOBJECT& arr, SQInteger start, T* dest, SQInteger count) {
+        HSQOBJECT chunk[CHUNK_SIZE];
+        HSQOBJECT key;
+        sq_resetobject(&key);
+        key._type = OT_INTEGER;
+
+        for (SQInteger done = 0; done < count; done += CHUNK_SIZE) {
+            SQInteger n = (count - done < CHUNK_SIZE) ? count - done : SQInteger(CHUNK_SIZE);
+            unsigned kinds = 0;
+            for (SQInteger i = 0; i < n; ++i) {
+                key._unVal.nInteger = start + done + i;
+                if (SQ_FAILED(sq_direct_get(vm, &arr, &key, &chunk[i], true))) {
+                    Convert(vm, chunk, dest + done, i);
+                    return done + i;
+                }
+                kinds |= (chunk[i]._type == OT_INTEGER) ? 1u : (chunk[i]._type == OT_FLOAT ? 2u : 4u);
+            }
+
+            T* out = dest + done;
+            if (kinds == 1u) {
+                for (SQInteger i = 0; i < n; ++i)
+                    out[i] = FromInteger(chunk[i]._unVal.nInteger);
+            } else if (kinds == 2u) {
+                for (SQInteger i = 0; i < n; ++i)
+                    out[i] = FromFloat(chunk[i]._unVal.fFloat);
+            } else {
+                Convert(vm, chunk, out, n);
+            }
+        }
+        return count;
+    }
+
+    /// Stores count elements of src into the array at stack index idx starting at index start (the array must be large enough)
+    static void Write(HSQUIRRELVM vm, SQInteger idx, SQInteger start, const T* src, SQInteger count) {
+        if (idx < 0)
+            idx = sq_gettop(vm) + idx + 1;
+        for (SQInteger i = 0; i < count; ++i) {
+            sq_pushinteger(vm, start + i);
+            PushVar(vm, src[i]);
+            SQRAT_VERIFY(SQ_SUCCEEDED(sq_rawset(vm, idx)));
+        }
+    }
+
+private:
+
+    // Same conversion rules as getAsInt / getAsFloat
+    static T FromInteger(SQInteger v) { return static_cast<T>(v); }
+
+    template <typename U = T>
+    static SQRAT_STD::enable_if_t<SQRAT_STD::is_integral<U>::value, T> FromFloat(SQFloat v) {
+        return static_cast<T>(static_cast<int>(v));
+    }
+
+    template <typename U = T>
+    static SQRAT_STD::enable_if_t<!SQRAT_STD::is_integral<U>::value, T> FromFloat(SQFloat v) {
+        return static_cast<T>(v);
+    }
+
+    static void Convert(HSQUIRRELVM vm, const HSQOBJECT* objs, T* out, SQInteger n) {
+        for (SQInteger i = 0; i < n; ++i) {
+            switch (objs[i]._type) {
+              case OT_INTEGER: out[i] = FromInteger(objs[i]._unVal.nInteger); break;
+              case OT_FLOAT:   out[i] = FromFloat(objs[i]._unVal.fFloat); break;
+              default:
+                  sq_pushobject(vm, objs[i]);
+                  out[i] = Var<T>(vm, -1).value;
+                  sq_pop(vm, 1);
+                  break;
+            }
+        }
+    }
+};
+
 class ArrayBase : public Object {
 public:
     ArrayBase() {
@@ -162,6 +252,89 @@ public:
         sq_pop(vm, 2); // pops the null iterator and the array object
     }
 
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Copies elements of the Array into a C array of arithmetic type
+    ///
+    /// \param dest  C array to be filled
+    /// \param count Maximum amount of elements to copy
+    /// \param start Index of the first element of the Array to copy
+    ///
+    /// \return The amount of elements actually copied
+    ///
+    /// \remarks
+    /// Much faster than GetArray for large arrays: see BulkNumeric.
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    template <typename T>
+    SQInteger CopyTo(T* dest, SQInteger count, SQInteger start = 0) const {
+        SQInteger n = Length() - start;
+        if (n > count)
+            n = count;
+        if (n <= 0)
+            return 0;
+        return BulkNumeric<T>::Read(vm, obj, start, dest, n);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Replaces the contents of the Array with the elements of a C array of arithmetic type
+    ///
+    /// \param src   C array to read the elements from
+    /// \param count The amount of elements in the C array
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    template <typename T>
+    ArrayBase& AssignFrom(const T* src, SQInteger count) {
+        sq_pushobject(vm, GetObject());
+        SQRAT_VERIFY(SQ_SUCCEEDED(sq_arrayresize(vm, -1, count)));
+        BulkNumeric<T>::Write(vm, -1, 0, src, count);
+        sq_pop(vm,1); // pop array
+        return *this;
+    }
+
+#if defined(SQRAT_HAS_SPAN)
+    template <typename T>
+    SQInteger CopyTo(span<T> dest, SQInteger start = 0) const {
+        return CopyTo(dest.data(), static_cast<SQInteger>(dest.size()), start);
+    }
+
+    // span<T> rather than span<const T> so T is deduced from spans of mutable elements too
+    template <typename T, typename = SQRAT_STD::enable_if_t<SQRAT_STD::is_arithmetic<SQRAT_STD::remove_const_t<T>>::value>>
+    ArrayBase& AssignFrom(span<T> src) {
+        return AssignFrom(src.data(), static_cast<SQInteger>(src.size()));
+    }
+#endif
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Appends all elements of a C++ range to the end of the Array
+    ///
+    /// \remarks
+    /// For forward iterators the Array storage is resized once and the elements are stored in a single pass,
+    /// input iterators fall back to appending the elements one by one.
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    template<class It>
+    ArrayBase& AppendRange(It first, It last) {
+        sq_pushobject(vm, GetObject());
+        AppendRangeImpl(first, last, typename SQRAT_STD::iterator_traits<It>::iterator_category());
+        sq_pop(vm,1); // pop array
+        return *this;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Stores count elements starting from first into the array at stack index idx, beginning at index start
+    ///
+    /// \remarks
+    /// The array must already be large enough (see sq_newarray and sq_arrayresize).
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    template<class It>
+    static void StoreRange(HSQUIRRELVM vm, SQInteger idx, SQInteger start, It first, SQInteger count) {
+        if (idx < 0)
+            idx = sq_gettop(vm) + idx + 1;
+        for (SQInteger i = 0; i < count; ++i, ++first) {
+            sq_pushinteger(vm, start + i);
+            PushVar(vm, *first);
+            SQRAT_VERIFY(SQ_SUCCEEDED(sq_rawset(vm, idx)));
+        }
+    }
+
     template<class V>
     ArrayBase& Append(const V& val) {
         sq_pushobject(vm, GetObject());
@@ -249,6 +422,25 @@ public:
         sq_pop(vm, 1); // pop array
         return ok;
     }
+
+private:
+
+    // Expects the array on top of the stack
+    template<class It>
+    void AppendRangeImpl(It first, It last, SQRAT_STD::forward_iterator_tag) {
+        SQInteger count = static_cast<SQInteger>(SQRAT_STD::distance(first, last));
+        SQInteger base = sq_getsize(vm, -1);
+        SQRAT_VERIFY(SQ_SUCCEEDED(sq_arrayresize(vm, -1, base + count)));
+        StoreRange(vm, -1, base, first, count);
+    }
+
+    template<class It>
+    void AppendRangeImpl(It first, It last, SQRAT_STD::input_iterator_tag) {
+        for (; first != last; ++first) {
+            PushVar(vm, *first);
+            sq_arrayappend(vm, -2);
+        }
+    }
 };
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -272,6 +464,39 @@ public:
 
     Array(HSQOBJECT o, HSQUIRRELVM v) : ArrayBase(o, v) {
     }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Creates an Array holding the elements of a C++ range
+    ///
+    /// \remarks
+    /// For forward iterators the Array is allocated with its final size, so no regrowth happens while filling it.
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    template<class It>
+    static Array FromRange(HSQUIRRELVM v, It first, It last) {
+        SQRAT_ASSERT(v);
+        return FromRangeImpl(v, first, last, typename SQRAT_STD::iterator_traits<It>::iterator_category());
+    }
+
+private:
+
+    template<class It>
+    static Array FromRangeImpl(HSQUIRRELVM v, It first, It last, SQRAT_STD::forward_iterator_tag) {
+        SQInteger count = static_cast<SQInteger>(SQRAT_STD::distance(first, last));
+        HSQOBJECT o;
+        sq_newarray(v, count);
+        StoreRange(v, -1, 0, first, count);
+        SQRAT_VERIFY(SQ_SUCCEEDED(sq_getstackobj(v, -1, &o)));
+        Array ret(o, v); // must addref before the pop!
+        sq_pop(v, 1);
+        return ret;
+    }
+
+    template<class It>
+    static Array FromRangeImpl(HSQUIRRELVM v, It first, It last, SQRAT_STD::input_iterator_tag) {
+        Array ret(v);
+        ret.AppendRange(first, last);
+        return ret;
+    }
 };
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,371 @@
+// Sqrat: altered version by Gaijin Entertainment Corp.
+// sqratBindingPlan: Bindings recorded once and applied to many VMs
+//
+
+//
+// Copyright (c) 2009 Brandon Jones
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//  claim that you wrote the original software. If you use this software
+//  in a product, an acknowledgment in the product documentation would be
+//  appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//  misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source
+//  distribution.
+//
+
+
+
+#pragma once
+#if !defined(_SQRAT_BINDING_PLAN_H_)
+#define _SQRAT_BINDING_PLAN_H_
+
+#include <squirrel.h>
+#include <string.h>
+
+#include "sqratClass.h"
+#include "sqratGlobalMethods.h"
+#include "sqratMemberMethods.h"
+#include "sqratUtil.h"
+
+#if defined(SQRAT_HAS_EASTL)
+# include <EASTL/vector.h>
+# include <EASTL/type_traits.h>
+#else
+# include <vector>
+# include <type_traits>
+#endif
+
+namespace Sqrat {
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Classes, functions and constants recorded once and bound to any number of VMs
+///
+/// \remarks
+/// A plan is a convenience for binding the same API to many VMs from one description; it is not meaningfully faster
+/// than binding directly. Recording resolves what does not depend on the VM (thunks, parameter checks, the bytes of
+/// the bound function or member pointers and the lengths of the names), but that was never the expensive part: per
+/// VM, every class still goes through the ClassT constructor, and every member still costs a name push, a userdata,
+/// a closure and a new slot, exactly as with Class::Func and friends. Apply() only saves a table push and pop and a
+/// strlen per member.
+///
+/// Bound functions and member pointers must be trivially copyable. Base classes must be added before the classes
+/// deriving from them. A plan is immutable once recorded and may be applied from several threads at once.
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class BindingPlan {
+public:
+    /// Where a recorded closure is stored
+    enum Target {
+        TargetObject = 0, ///< Class object or root table
+        TargetGetTable,   ///< Getters of a class
+        TargetSetTable,   ///< Setters of a class
+        TargetCount
+    };
+
+    /// Native closure ready to be created in any VM
+    struct Slot {
+        string name;
+        SQFUNCTION thunk = nullptr;
+        SQInteger nparamscheck = 0;
+        const SQChar* typemask = nullptr;
+        unsigned char target = TargetObject;
+        bool isStatic = false;
+        unsigned char payloadSize = 0; ///< Size of the free variable userdata, 0 for none
+        union {
+            unsigned char payload[32];
+            void* alignment;
+        };
+    };
+
+    /// Creates the recorded closures, the target tables are expected at base, base+1 and base+2 of the stack
+    static void ApplySlots(HSQUIRRELVM vm, const SQRAT_STD::vector<Slot>& slots, SQInteger base) {
+        for (const Slot& s : slots) {
+            sq_pushstring(vm, s.name.c_str(), static_cast<SQInteger>(s.name.size()));
+            if (s.payloadSize) {
+                memcpy(sq_newuserdata(vm, s.payloadSize), s.payload, s.payloadSize);
+                sq_newclosure(vm, s.thunk, 1);
+            } else {
+                sq_newclosure(vm, s.thunk, 0);
+            }
+            if (s.nparamscheck != 0 || s.typemask)
+                SQRAT_VERIFY(SQ_SUCCEEDED(sq_setparamscheck(vm, s.nparamscheck, s.typemask)));
+            SQRAT_VERIFY(SQ_SUCCEEDED(sq_newslot(vm, base + s.target, s.isStatic)));
+        }
+    }
+
+    template<class F>
+    static Slot MakeSlot(const SQChar* name, Target target, const F& payload, SQFUNCTION thunk, SQInteger nparamscheck, bool isStatic = false) {
+        static_assert(SQRAT_STD::is_trivially_copyable<F>::value, "bound functions must be trivially copyable");
+        static_assert(sizeof(F) <= sizeof(Slot::payload), "bound function is too large");
+        Slot s;
+        s.name = name;
+        s.thunk = thunk;
+        s.nparamscheck = nparamscheck;
+        s.target = static_cast<unsigned char>(target);
+        s.isStatic = isStatic;
+        s.payloadSize = static_cast<unsigned char>(sizeof(F));
+        memcpy(s.payload, &payload, sizeof(F));
+        return s;
+    }
+
+    class ClassPlanBase {
+    public:
+        explicit ClassPlanBase(const SQChar* className) : name(className) {}
+        virtual ~ClassPlanBase() {}
+
+        /// Binds the class in the VM and stores it in the table at the given stack index
+        virtual void Apply(HSQUIRRELVM vm, SQInteger tableIdx) const = 0;
+
+        const string& GetName() const { return name; }
+
+    protected:
+        string name;
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Recorded class, mirroring the binding methods of Sqrat::Class
+    ///
+    /// \tparam C      Class type to expose
+    /// \tparam ClassT Binding class used to create the class in a VM (Class<C, A> or DerivedClass<C, B, A>)
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    template<class C, class ClassT = Class<C> >
+    class ClassPlan : public ClassPlanBase {
+    public:
+        explicit ClassPlan(const SQChar* className) : ClassPlanBase(className) {}
+
+        /// Binds a class function
+        template<class F>
+        ClassPlan& Func(const SQChar* name, F method) {
+            slots.push_back(MakeSlot(name, TargetObject, method, SqMemberFunc<C, F>(), 1+SqGetArgCount<F>()));
+            return *this;
+        }
+
+        /// Binds a global function as a class function
+        template<class F>
+        ClassPlan& GlobalFunc(const SQChar* name, F method) {
+            slots.push_back(MakeSlot(name, TargetObject, method, SqMemberGlobalThunk<F>(), SqGetArgCount<F>()));
+            return *this;
+        }
+
+        /// Binds a static class function
+        template<class F>
+        ClassPlan& StaticFunc(const SQChar* name, F method) {
+            slots.push_back(MakeSlot(name, TargetObject, method, SqGlobalThunk<F>(), 1+SqGetArgCount<F>()));
+            return *this;
+        }
+
+        /// Binds a raw Squirrel closure to the class
+        ClassPlan& SquirrelFunc(const SQChar* name, SQFUNCTION func, SQInteger nparamscheck = 0, const SQChar* typemask = nullptr) {
+            Slot s;
+            s.name = name;
+            s.thunk = func;
+            s.nparamscheck = nparamscheck;
+            s.typemask = typemask;
+            slots.push_back(s);
+            return *this;
+        }
+
+        /// Binds a class variable
+        template<class V>
+        ClassPlan& Var(const SQChar* name, V C::* var) {
+            slots.push_back(MakeSlot(name, TargetGetTable, var, &sqDefaultGet<C, V>, 0));
+            slots.push_back(MakeSlot(name, TargetSetTable, var, &sqDefaultSet<C, V>, 0));
+            return *this;
+        }
+
+        /// Binds a class variable without a setter
+        template<class V>
+        ClassPlan& ConstVar(const SQChar* name, V C::* var) {
+            slots.push_back(MakeSlot(name, TargetGetTable, var, &sqDefaultGet<C, V>, 0));
+            return *this;
+        }
+
+        /// Binds a class static variable
+        template<class V>
+        ClassPlan& StaticVar(const SQChar* name, V* var) {
+            slots.push_back(MakeSlot(name, TargetGetTable, var, &sqStaticGet<C, V>, 0));
+            slots.push_back(MakeSlot(name, TargetSetTable, var, &sqStaticSet<C, V>, 0));
+            return *this;
+        }
+
+        /// Binds a class property
+        template<class F1, class F2>
+        ClassPlan& Prop(const SQChar* name, F1 getMethod, F2 setMethod) {
+            if (getMethod != NULL)
+                slots.push_back(MakeSlot(name, TargetGetTable, getMethod, SqMemberOverloadedFunc<C, F1>(), 0));
+            if (setMethod != NULL)
+                slots.push_back(MakeSlot(name, TargetSetTable, setMethod, SqMemberOverloadedFunc<C, F2>(), 0));
+            return *this;
+        }
+
+        /// Binds a read-only class property
+        template<class F>
+        ClassPlan& Prop(const SQChar* name, F getMethod) {
+            slots.push_back(MakeSlot(name, TargetGetTable, getMethod, SqMemberOverloadedFunc<C, F>(), 0));
+            return *this;
+        }
+
+        /// Binds a class property (using global functions instead of member functions)
+        template<class F1, class F2>
+        ClassPlan& GlobalProp(const SQChar* name, F1 getMethod, F2 setMethod) {
+            if (getMethod != NULL)
+                slots.push_back(MakeSlot(name, TargetGetTable, getMethod, SqMemberGlobalOverloadedFunc<F1>(), 0));
+            if (setMethod != NULL)
+                slots.push_back(MakeSlot(name, TargetSetTable, setMethod, SqMemberGlobalOverloadedFunc<F2>(), 0));
+            return *this;
+        }
+
+        /// Binds a read-only class property (using a global function instead of a member function)
+        template<class F>
+        ClassPlan& GlobalProp(const SQChar* name, F getMethod) {
+            slots.push_back(MakeSlot(name, TargetGetTable, getMethod, SqMemberGlobalOverloadedFunc<F>(), 0));
+            return *this;
+        }
+
+        /// Binds a constructor with the given arguments
+        template<class... Arg>
+        ClassPlan& Ctor() {
+            setups.push_back(&BindCtor<Arg...>);
+            return *this;
+        }
+
+        /// Records an arbitrary step run on the binding class (e.g. overloads or values)
+        ClassPlan& Setup(void (*step)(ClassT&)) {
+            setups.push_back(step);
+            return *this;
+        }
+
+        virtual void Apply(HSQUIRRELVM vm, SQInteger tableIdx) const {
+            ClassT cls(vm, string(name));
+            for (void (*step)(ClassT&) : setups)
+                step(cls);
+
+            ClassData<C>* cd = ClassType<C>::getClassData(vm);
+            SQInteger top = sq_gettop(vm);
+            sq_pushobject(vm, cd->classObj);
+            sq_pushobject(vm, cd->getTable);
+            sq_pushobject(vm, cd->setTable);
+            ApplySlots(vm, slots, top + 1);
+
+            sq_pushstring(vm, name.c_str(), static_cast<SQInteger>(name.size()));
+            sq_push(vm, top + 1);
+            SQRAT_VERIFY(SQ_SUCCEEDED(sq_newslot(vm, tableIdx, SQFalse)));
+            sq_settop(vm, top);
+        }
+
+    private:
+        template<class... Arg>
+        static void BindCtor(ClassT& cls) {
+            cls.template Ctor<Arg...>();
+        }
+
+        SQRAT_STD::vector<Slot> slots;
+        SQRAT_STD::vector<void (*)(ClassT&)> setups;
+    };
+
+    /// Adds a class, bound to the root table under its name
+    template<class C, class ClassT = Class<C> >
+    ClassPlan<C, ClassT>& AddClass(const SQChar* name) {
+        ClassPlan<C, ClassT>* plan = new ClassPlan<C, ClassT>(name);
+        classes.push_back(SQRAT_STD::shared_ptr<ClassPlanBase>(plan));
+        return *plan;
+    }
+
+    /// Binds a global function to the root table
+    template<class F>
+    BindingPlan& Func(const SQChar* name, F method) {
+        rootSlots.push_back(MakeSlot(name, TargetObject, method, SqGlobalThunk<F>(), 1+SqGetArgCount<F>()));
+        return *this;
+    }
+
+    /// Binds a raw Squirrel closure to the root table
+    BindingPlan& SquirrelFunc(const SQChar* name, SQFUNCTION func, SQInteger nparamscheck = 0, const SQChar* typemask = nullptr) {
+        Slot s;
+        s.name = name;
+        s.thunk = func;
+        s.nparamscheck = nparamscheck;
+        s.typemask = typemask;
+        rootSlots.push_back(s);
+        return *this;
+    }
+
+    /// Adds a constant to the const table
+    BindingPlan& Const(const SQChar* name, SQInteger val) {
+        ConstEntry c(name, OT_INTEGER);
+        c.i = val;
+        consts.push_back(c);
+        return *this;
+    }
+
+    BindingPlan& Const(const SQChar* name, int val) {
+        return Const(name, SQInteger(val));
+    }
+
+    BindingPlan& Const(const SQChar* name, float val) {
+        ConstEntry c(name, OT_FLOAT);
+        c.f = SQFloat(val);
+        consts.push_back(c);
+        return *this;
+    }
+
+    BindingPlan& Const(const SQChar* name, const SQChar* val) {
+        ConstEntry c(name, OT_STRING);
+        c.s = val;
+        consts.push_back(c);
+        return *this;
+    }
+
+    /// Binds everything recorded to a VM
+    void Apply(HSQUIRRELVM vm) const {
+        SQInteger top = sq_gettop(vm);
+        sq_pushroottable(vm);
+        for (const SQRAT_STD::shared_ptr<ClassPlanBase>& c : classes)
+            c->Apply(vm, top + 1);
+        ApplySlots(vm, rootSlots, top + 1);
+
+        sq_pushconsttable(vm);
+        for (const ConstEntry& c : consts) {
+            sq_pushstring(vm, c.name.c_str(), static_cast<SQInteger>(c.name.size()));
+            if (c.type == OT_INTEGER)
+                sq_pushinteger(vm, c.i);
+            else if (c.type == OT_FLOAT)
+                sq_pushfloat(vm, c.f);
+            else
+                sq_pushstring(vm, c.s.c_str(), static_cast<SQInteger>(c.s.size()));
+            SQRAT_VERIFY(SQ_SUCCEEDED(sq_newslot(vm, -3, SQFalse)));
+        }
+        sq_settop(vm, top);
+    }
+
+private:
+    struct ConstEntry {
+        ConstEntry(const SQChar* n, SQObjectType t) : name(n), type(t), i(0), f(0) {}
+
+        string name;
+        SQObjectType type;
+        SQInteger i;
+        SQFloat f;
+        string s;
+    };
+
+    SQRAT_STD::vector<SQRAT_STD::shared_ptr<ClassPlanBase> > classes;
+    SQRAT_STD::vector<Slot> rootSlots;
+    SQRAT_STD::vector<ConstEntry> consts;
+};
+
+}
+
+#endif
@@ -0,0 +1,275 @@
+// Sqrat: altered version by Gaijin Entertainment Corp.
+// sqratBudget: Time and instruction budgets for script calls
+//
+
+//
+// Copyright (c) 2009 Brandon Jones
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//  claim that you wrote the original software. If you use this software
+//  in a product, an acknowledgment in the product documentation would be
+//  appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//  misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source
+//  distribution.
+//
+
+
+#pragma once
+#if !defined(_SQRAT_BUDGET_H_)
+#define _SQRAT_BUDGET_H_
+
+#include <squirrel.h>
+
+#include "sqratFunction.h"
+#include "sqratScript.h"
+#include "sqratUtil.h"
+
+#if defined(SQRAT_HAS_EASTL)
+# include <EASTL/chrono.h>
+#else
+# include <chrono>
+#endif
+
+// Budgeted calls abort overrunning scripts by throwing a C++ exception through the VM, the only way a debug hook can
+// stop one. They are only available when SQRAT_BUDGET_ABORT_WITH_EXCEPTIONS is defined: Quirrel itself must then be
+// built with exception support and unwind tables, otherwise the exception can't pass its frames. The library can't
+// detect that, so it is never enabled automatically.
+#if defined(SQRAT_BUDGET_ABORT_WITH_EXCEPTIONS) && !defined(__cpp_exceptions) && !defined(_CPPUNWIND)
+# error SQRAT_BUDGET_ABORT_WITH_EXCEPTIONS requires C++ exceptions
+#endif
+
+namespace Sqrat {
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Limits of a budgeted script call
+///
+/// \remarks
+/// Operations are debug hook events: function calls, returns and executed lines. Line events only exist in code
+/// compiled with debug info (sq_enabledebuginfo), so enable it before compiling scripts whose loops must be
+/// interruptible. The deadline is checked every CLOCK_SAMPLE_INTERVAL operations.
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct ExecutionBudget {
+    typedef SQRAT_STD::chrono::steady_clock Clock;
+    enum { CLOCK_SAMPLE_INTERVAL = 64 };
+
+    SQInteger maxOps = 0; ///< 0 means unlimited
+    Clock::time_point deadline = (Clock::time_point::max)();
+
+    static ExecutionBudget Ops(SQInteger ops) {
+        ExecutionBudget b;
+        b.maxOps = ops;
+        return b;
+    }
+
+    static ExecutionBudget Until(Clock::time_point when) {
+        ExecutionBudget b;
+        b.deadline = when;
+        return b;
+    }
+
+    static ExecutionBudget For(Clock::duration time) {
+        return Until(Clock::now() + time);
+    }
+
+    bool IsUnlimited() const { return maxOps == 0 && deadline == (Clock::time_point::max)(); }
+};
+
+enum class BudgetResult {
+    Completed, ///< The call finished within the budget
+    Failed,    ///< The script raised an error
+    Exceeded   ///< The budget ran out and the call was aborted
+};
+
+#if defined(SQRAT_BUDGET_ABORT_WITH_EXCEPTIONS)
+
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Debug hook enforcing ExecutionBudget on a disposable thread
+///
+/// \remarks
+/// On overrun the hook throws Abort through the VM to unwind the call right away.
+/// The hook finds its state through a thread-local list of active calls, leaving the thread's foreign pointer alone.
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class BudgetHook {
+public:
+    /// Thrown through the VM to unwind the budgeted call, never escapes Call()
+    struct Abort {};
+
+    explicit BudgetHook(const ExecutionBudget& b) : budget(b), ops(0), exceeded(false), thread(nullptr), outer(nullptr) {}
+
+    bool IsExceeded() const { return exceeded; }
+    SQInteger GetOps() const { return ops; }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Calls the closure at the given stack position of vm with its environment and nargs arguments above it
+    ///
+    /// \remarks
+    /// The call runs on a new thread with the hook installed, so vm itself never gets a hook and unbudgeted calls
+    /// don't pay for it. The thread is thrown away afterwards. The closure and arguments are popped.
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    BudgetResult Call(HSQUIRRELVM vm, SQInteger nargs, string* errMsg) {
+        SQInteger callTop = sq_gettop(vm) - nargs - 2; // closure and environment
+        thread = sq_newthread(vm, nargs + 16); // stays referenced from the vm stack
+        outer = Active();
+        Active() = this;
+        sq_setnativedebughook(thread, &BudgetHook::Hook);
+
+        for (SQInteger i = callTop + 1; i <= callTop + nargs + 2; ++i)
+            sq_move(thread, vm, i);
+
+        bool ok = false;
+        try {
+            ok = SQ_SUCCEEDED(sq_call(thread, nargs + 1, SQFalse, SQTrue));
+        }
+        catch (const Abort&) {
+            ok = false;
+        }
+        if (exceeded && errMsg)
+            *errMsg = _SC("execution budget exceeded");
+        else if (!ok && errMsg)
+            *errMsg = LastErrorString(thread);
+
+        Active() = outer;
+        thread = nullptr;
+        sq_settop(vm, callTop);
+        if (exceeded)
+            return BudgetResult::Exceeded;
+        return ok ? BudgetResult::Completed : BudgetResult::Failed;
+    }
+
+private:
+    static BudgetHook*& Active() {
+        static thread_local BudgetHook* innermost = nullptr;
+        return innermost;
+    }
+
+    static BudgetHook* Find(HSQUIRRELVM v) {
+        BudgetHook* h = Active();
+        while (h && h->thread != v)
+            h = h->outer;
+        return h;
+    }
+
+    static void Hook(HSQUIRRELVM v, SQInteger /*type*/, const SQChar* /*sourcename*/, SQInteger /*line*/,
+                     const SQChar* /*funcname*/) {
+        BudgetHook* self = Find(v);
+        if (!self || self->exceeded)
+            return;
+        ++self->ops;
+        if ((self->budget.maxOps && self->ops > self->budget.maxOps) ||
+            (self->ops % ExecutionBudget::CLOCK_SAMPLE_INTERVAL == 0 &&
+             ExecutionBudget::Clock::now() >= self->budget.deadline))
+        {
+            self->exceeded = true;
+            throw Abort();
+        }
+    }
+
+    ExecutionBudget budget;
+    SQInteger ops;
+    bool exceeded;
+    HSQUIRRELVM thread;
+    BudgetHook* outer; ///< Enclosing budgeted call on this OS thread
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Calls a function and aborts it if it runs out of budget
+///
+/// \param func   Function to call
+/// \param budget Limits of the call, an unlimited budget is a plain Function::Execute()
+/// \param args   Arguments of the call
+///
+/// \remarks
+/// Overruns are noticed at debug hook events (calls, returns and lines), so only code that produces them can be
+/// stopped: a loop compiled without debug info that calls no function runs on unchecked. Compile budgeted scripts
+/// with sq_enabledebuginfo enabled (or a BytecodeCache created with debug info).
+/// Functions called by native code within the budgeted call (through a Function bound to the main VM) are not
+/// limited.
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename... Args>
+inline BudgetResult ExecuteWithBudget(const Function& func, const ExecutionBudget& budget, Args const&... args) {
+    if (budget.IsUnlimited())
+        return func.Execute(args...) ? BudgetResult::Completed : BudgetResult::Failed;
+
+    HSQUIRRELVM vm = func.GetVM();
+    sq_pushobject(vm, func.GetFunc());
+    sq_pushobject(vm, func.GetEnv());
+    int dummy[] = {0, (PushVar(vm, args), 0)...};
+    (void)dummy;
+
+    BudgetHook hook(budget);
+    return hook.Call(vm, sizeof...(Args), nullptr);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Runs a compiled script and aborts it if it runs out of budget
+///
+/// \param script  Compiled script
+/// \param budget  Limits of the run
+/// \param errMsg  String that is filled with the error if the script fails
+/// \param context Optional environment (root table by default)
+///
+/// \remarks
+/// Overruns are noticed at debug hook events (calls, returns and lines), so only code that produces them can be
+/// stopped: a loop compiled without debug info that calls no function runs on unchecked. Compile budgeted scripts
+/// with sq_enabledebuginfo enabled (or a BytecodeCache created with debug info).
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline BudgetResult RunWithBudget(Script& script, const ExecutionBudget& budget, string& errMsg, Object* context = NULL) {
+    if (!script.Materialize(errMsg) || script.IsNull())
+        return BudgetResult::Failed;
+    if (budget.IsUnlimited())
+        return script.Run(errMsg, context) ? BudgetResult::Completed : BudgetResult::Failed;
+
+    HSQUIRRELVM vm = script.GetVM();
+    sq_pushobject(vm, script.GetObject());
+    if (!context)
+        sq_pushroottable(vm);
+    else
+        sq_pushobject(vm, context->GetObject());
+
+    BudgetHook hook(budget);
+    return hook.Call(vm, 0, &errMsg);
+}
+
+#else
+
+template <class... T>
+struct BudgetAbortUnavailable : SQRAT_STD::false_type {};
+
+// Without a way to stop the script a budget could only be reported after the fact, so the calls don't build
+template <typename... Args>
+inline BudgetResult ExecuteWithBudget(const Function&, const ExecutionBudget&, Args const&...) {
+    static_assert(BudgetAbortUnavailable<Args...>::value, "budgeted calls require SQRAT_BUDGET_ABORT_WITH_EXCEPTIONS");
+    return BudgetResult::Failed;
+}
+
+template <class ScriptT>
+inline BudgetResult RunWithBudget(ScriptT&, const ExecutionBudget&, string&, Object* = NULL) {
+    static_assert(BudgetAbortUnavailable<ScriptT>::value, "budgeted calls require SQRAT_BUDGET_ABORT_WITH_EXCEPTIONS");
+    return BudgetResult::Failed;
+}
+
+#endif
+
+}
+
+#endif
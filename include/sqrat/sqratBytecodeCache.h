@@ -0,0 +1,394 @@
+// Sqrat: altered version by Gaijin Entertainment Corp.
+// sqratBytecodeCache: On-disk cache of compiled scripts
+//
+
+//
+// Copyright (c) 2009 Brandon Jones
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//  claim that you wrote the original software. If you use this software
+//  in a product, an acknowledgment in the product documentation would be
+//  appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//  misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source
+//  distribution.
+//
+
+
+#pragma once
+#if !defined(_SQRAT_BYTECODE_CACHE_H_)
+#define _SQRAT_BYTECODE_CACHE_H_
+
+#include <squirrel.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sqratUtil.h"
+
+#if defined(SQRAT_HAS_EASTL)
+# include <EASTL/atomic.h>
+# include <EASTL/chrono.h>
+#else
+# include <atomic>
+# include <chrono>
+#endif
+
+#if defined(_WIN32)
+# if !defined(NOMINMAX)
+#  define NOMINMAX
+#  define SQRAT_UNDEF_NOMINMAX
+# endif
+# if !defined(WIN32_LEAN_AND_MEAN)
+#  define WIN32_LEAN_AND_MEAN
+#  define SQRAT_UNDEF_WIN32_LEAN_AND_MEAN
+# endif
+# include <windows.h>
+# if defined(SQRAT_UNDEF_NOMINMAX)
+#  undef NOMINMAX
+#  undef SQRAT_UNDEF_NOMINMAX
+# endif
+# if defined(SQRAT_UNDEF_WIN32_LEAN_AND_MEAN)
+#  undef WIN32_LEAN_AND_MEAN
+#  undef SQRAT_UNDEF_WIN32_LEAN_AND_MEAN
+# endif
+#else
+# include <unistd.h>
+#endif
+
+namespace Sqrat {
+
+/// SQREADFUNC reading serialized closures from memory
+struct BytecodeMemoryReader {
+    const char* p;
+    size_t left;
+
+    static SQInteger Read(SQUserPointer up, SQUserPointer buf, SQInteger n) {
+        BytecodeMemoryReader* r = static_cast<BytecodeMemoryReader*>(up);
+        if (n < 0 || size_t(n) > r->left)
+            return -1;
+        memcpy(buf, r->p, size_t(n));
+        r->p += n;
+        r->left -= size_t(n);
+        return n;
+    }
+};
+
+/// What besides the source changes compiled code: constants are inlined, and options change the emitted code
+struct BytecodeKey {
+    enum Flags {
+        DebugInfo = 1 ///< Compiled with sq_enabledebuginfo
+    };
+
+    static const uint64_t FnvBasis = 14695981039346656037ull;
+
+    static void Mix(uint64_t& h, const void* data, size_t size) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i)
+            h = (h ^ p[i]) * 1099511628211ull;
+    }
+
+    /// Digest of the VM const table, independent of the order of its slots
+    static uint64_t Constants(HSQUIRRELVM vm) {
+        sq_pushconsttable(vm);
+        uint64_t h = HashValue(vm, -1, 0);
+        sq_pop(vm, 1); // pop const table
+        return h;
+    }
+
+private:
+    // Digest of a constant; entries of tables (enums) are combined by addition, so slot order doesn't matter
+    static uint64_t HashValue(HSQUIRRELVM vm, SQInteger idx, int depth) {
+        const SQObjectType type = sq_gettype(vm, idx);
+        uint64_t h = FnvBasis;
+        Mix(h, &type, sizeof(type));
+        switch (type) {
+        case OT_INTEGER: {
+            SQInteger i = 0;
+            sq_getinteger(vm, idx, &i);
+            Mix(h, &i, sizeof(i));
+            break;
+        }
+        case OT_FLOAT: {
+            SQFloat f = 0;
+            sq_getfloat(vm, idx, &f);
+            Mix(h, &f, sizeof(f));
+            break;
+        }
+        case OT_BOOL: {
+            SQBool b = SQFalse;
+            sq_getbool(vm, idx, &b);
+            Mix(h, &b, sizeof(b));
+            break;
+        }
+        case OT_STRING: {
+            const SQChar* str = nullptr;
+            SQInteger len = 0;
+            sq_getstringandsize(vm, idx, &str, &len);
+            Mix(h, str, size_t(len) * sizeof(SQChar));
+            break;
+        }
+        case OT_TABLE:
+        case OT_ARRAY: {
+            if (depth >= 8)
+                break;
+            if (idx < 0)
+                idx = sq_gettop(vm) + idx + 1;
+            uint64_t sum = 0;
+            sq_pushnull(vm);
+            while (SQ_SUCCEEDED(sq_next(vm, idx))) {
+                uint64_t entry = HashValue(vm, -2, depth + 1);
+                uint64_t value = HashValue(vm, -1, depth + 1);
+                Mix(entry, &value, sizeof(value));
+                sum += entry;
+                sq_pop(vm, 2); // pop key and value
+            }
+            sq_pop(vm, 1); // pop iterator
+            Mix(h, &sum, sizeof(sum));
+            break;
+        }
+        default:
+            break;
+        }
+        return h;
+    }
+
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Cache of compiled scripts in a directory, keyed by the hash of the source text and name
+///
+/// \remarks
+/// On a miss the source is compiled and the closure is written with sq_writeclosure; on a hit it is read back with
+/// sq_readclosure, skipping the compiler. Entries are only used if the Quirrel version and type sizes match.
+/// Constants are inlined by the compiler, so the contents of the VM const table are part of the key, as is the debug
+/// info option the cache compiles with (it is set on the VM with sq_enabledebuginfo before compiling).
+/// Use it through the Script::CompileString/CompileFile overloads taking a BytecodeCache.
+/// The cache is not available in SQUNICODE builds; scripts are then always compiled.
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class BytecodeCache {
+public:
+    typedef SQRAT_STD::chrono::steady_clock Clock;
+
+    struct Stats {
+        SQInteger hits = 0;
+        SQInteger misses = 0;
+        SQInteger storeFailures = 0;
+        Clock::duration loadTime = Clock::duration::zero();    ///< Spent reading cached closures
+        Clock::duration compileTime = Clock::duration::zero(); ///< Spent compiling on misses
+        Clock::duration savedTime = Clock::duration::zero();   ///< Estimated compile time avoided by hits
+        SQInteger compiledBytes = 0;
+    };
+
+    /// \param dir           Existing directory for cache files
+    /// \param withDebugInfo Compile with line information (sq_enabledebuginfo)
+    explicit BytecodeCache(const string& dir, bool withDebugInfo = false) : directory(dir), debugInfo(withDebugInfo) {}
+
+    const Stats& GetStats() const { return stats; }
+    void ResetStats() { stats = Stats(); }
+    const string& GetDirectory() const { return directory; }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Pushes the closure compiled from the source, loading it from the cache when possible
+    ///
+    /// \param vm     Target VM
+    /// \param source Script source
+    /// \param name   Script name (stored in the closure for error messages)
+    /// \param errMsg String that is filled with the compiler error
+    ///
+    /// \return False if the script does not compile (nothing is pushed)
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    bool Compile(HSQUIRRELVM vm, const string_view& source, const string_view& name, string& errMsg) {
+        string sourceName(name.data(), name.size());
+#if !defined(SQUNICODE)
+        const uint64_t consts = BytecodeKey::Constants(vm);
+        const uint64_t hash = Hash(source, name, consts, GetCompileFlags());
+        const string path = PathFor(hash);
+
+        Clock::time_point start = Clock::now();
+        if (Load(vm, path, Header::Make(hash, source.size(), consts, GetCompileFlags()))) {
+            Clock::duration elapsed = Clock::now() - start;
+            ++stats.hits;
+            stats.loadTime += elapsed;
+            if (stats.compiledBytes > 0) {
+                Clock::duration estimate = stats.compileTime * SQInteger(source.size()) / stats.compiledBytes;
+                if (estimate > elapsed)
+                    stats.savedTime += estimate - elapsed;
+            }
+            return true;
+        }
+        ++stats.misses;
+#endif
+        Clock::time_point compileStart = Clock::now();
+        sq_enabledebuginfo(vm, debugInfo);
+        if (SQ_FAILED(sq_compilebuffer(vm, source.data(), static_cast<SQInteger>(source.size()), sourceName.c_str(), true))) {
+            errMsg = LastErrorString(vm);
+            return false;
+        }
+        stats.compileTime += Clock::now() - compileStart;
+        stats.compiledBytes += static_cast<SQInteger>(source.size());
+#if !defined(SQUNICODE)
+        if (!Store(vm, path, Header::Make(hash, source.size(), consts, GetCompileFlags())))
+            ++stats.storeFailures;
+#endif
+        return true;
+    }
+
+    /// Reads a whole file into a string (UTF-8 BOM is skipped), returns false if it can't be read
+    static bool ReadFile(const string& path, string& text) {
+#if defined(SQUNICODE)
+        (void)path; (void)text;
+        return false;
+#else
+        FILE* f = fopen(path.c_str(), "rb");
+        if (!f)
+            return false;
+        fseek(f, 0, SEEK_END);
+        long size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        text.resize(size > 0 ? size_t(size) : 0);
+        bool ok = size >= 0 && fread(&text[0], 1, text.size(), f) == text.size();
+        fclose(f);
+        if (ok && text.size() >= 3 && (unsigned char)text[0] == 0xEF && (unsigned char)text[1] == 0xBB && (unsigned char)text[2] == 0xBF)
+            text.erase(0, 3);
+        return ok;
+#endif
+    }
+
+private:
+    struct Header {
+        uint32_t magic;
+        uint32_t format;
+        uint64_t sourceHash;
+        uint64_t sourceSize;
+        uint64_t constHash;
+        uint32_t compileFlags;
+        uint32_t reserved;
+        int64_t quirrelVersion;
+        uint32_t charSize;
+        uint32_t integerSize;
+        uint32_t floatSize;
+        uint32_t pointerSize;
+
+        static Header Make(uint64_t hash, uint64_t size, uint64_t consts, uint32_t flags) {
+            Header h;
+            memset(&h, 0, sizeof(h));
+            h.magic = 0x43525153; // "SQRC"
+            h.format = 2;
+            h.sourceHash = hash;
+            h.sourceSize = size;
+            h.constHash = consts;
+            h.compileFlags = flags;
+            h.quirrelVersion = sq_getversion();
+            h.charSize = sizeof(SQChar);
+            h.integerSize = sizeof(SQInteger);
+            h.floatSize = sizeof(SQFloat);
+            h.pointerSize = sizeof(void*);
+            return h;
+        }
+    };
+
+    uint32_t GetCompileFlags() const {
+        return debugInfo ? BytecodeKey::DebugInfo : 0;
+    }
+
+    // FNV-1a over the source, its name and what else changes the compiled code
+    static uint64_t Hash(const string_view& source, const string_view& name, uint64_t consts, uint32_t flags) {
+        uint64_t h = BytecodeKey::FnvBasis;
+        BytecodeKey::Mix(h, name.data(), name.size() * sizeof(SQChar));
+        BytecodeKey::Mix(h, "\0", 1);
+        BytecodeKey::Mix(h, source.data(), source.size() * sizeof(SQChar));
+        BytecodeKey::Mix(h, &consts, sizeof(consts));
+        BytecodeKey::Mix(h, &flags, sizeof(flags));
+        return h;
+    }
+
+    string PathFor(uint64_t hash) const {
+        char fileName[32];
+        snprintf(fileName, sizeof(fileName), "%016llx.cnut", (unsigned long long)hash);
+        string path = directory;
+        if (!path.empty() && path.back() != '/' && path.back() != '\\')
+            path += '/';
+        path += fileName;
+        return path;
+    }
+
+    static SQInteger ReadFunc(SQUserPointer file, SQUserPointer buf, SQInteger size) {
+        size_t n = fread(buf, 1, size_t(size), static_cast<FILE*>(file));
+        return n == size_t(size) ? SQInteger(n) : -1;
+    }
+
+    static SQInteger WriteFunc(SQUserPointer file, SQUserPointer buf, SQInteger size) {
+        return SQInteger(fwrite(buf, 1, size_t(size), static_cast<FILE*>(file)));
+    }
+
+#if !defined(SQUNICODE)
+    static bool Load(HSQUIRRELVM vm, const string& path, const Header& expected) {
+        FILE* f = fopen(path.c_str(), "rb");
+        if (!f)
+            return false;
+        Header header;
+        bool ok = fread(&header, sizeof(header), 1, f) == 1 && memcmp(&header, &expected, sizeof(header)) == 0 &&
+                  SQ_SUCCEEDED(sq_readclosure(vm, &ReadFunc, f));
+        fclose(f);
+        return ok;
+    }
+
+    // Writes the closure on top of the stack through a temporary file, so readers never see partial entries
+    static bool Store(HSQUIRRELVM vm, const string& path, const Header& header) {
+        const string tmpPath = TempPathFor(path);
+        FILE* f = fopen(tmpPath.c_str(), "wb");
+        if (!f)
+            return false;
+        bool ok = fwrite(&header, sizeof(header), 1, f) == 1 && SQ_SUCCEEDED(sq_writeclosure(vm, &WriteFunc, f));
+        ok = fclose(f) == 0 && ok;
+        ok = ok && Replace(tmpPath, path);
+        if (!ok)
+            remove(tmpPath.c_str());
+        return ok;
+    }
+
+    // Unique per process and call, so concurrent writers of the same entry don't share a temporary file
+    static string TempPathFor(const string& path) {
+        static SQRAT_STD::atomic<unsigned> counter(0);
+#if defined(_WIN32)
+        const unsigned long pid = GetCurrentProcessId();
+#else
+        const unsigned long pid = (unsigned long)getpid();
+#endif
+        char suffix[48];
+        snprintf(suffix, sizeof(suffix), ".%lu.%u.tmp", pid, counter.fetch_add(1));
+        return path + suffix;
+    }
+
+    // Moves the file over an existing entry in one step; the old entry stays readable until then
+    static bool Replace(const string& from, const string& to) {
+#if defined(_WIN32)
+        return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+        return rename(from.c_str(), to.c_str()) == 0;
+#endif
+    }
+#endif
+
+    string directory;
+    bool debugInfo;
+    Stats stats;
+};
+
+}
+
+#endif
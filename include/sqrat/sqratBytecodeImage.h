@@ -0,0 +1,426 @@
+// Sqrat: altered version by Gaijin Entertainment Corp.
+// sqratBytecodeImage: Packed images of compiled scripts
+//
+
+//
+// Copyright (c) 2009 Brandon Jones
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//  claim that you wrote the original software. If you use this software
+//  in a product, an acknowledgment in the product documentation would be
+//  appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//  misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source
+//  distribution.
+//
+
+
+#pragma once
+#if !defined(_SQRAT_BYTECODE_IMAGE_H_)
+#define _SQRAT_BYTECODE_IMAGE_H_
+
+#include <squirrel.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sqratBytecodeCache.h"
+#include "sqratUtil.h"
+
+#if defined(SQRAT_HAS_EASTL)
+# include <EASTL/vector.h>
+#else
+# include <vector>
+#endif
+
+#if defined(_WIN32)
+# if !defined(NOMINMAX)
+#  define NOMINMAX
+#  define SQRAT_UNDEF_NOMINMAX
+# endif
+# if !defined(WIN32_LEAN_AND_MEAN)
+#  define WIN32_LEAN_AND_MEAN
+#  define SQRAT_UNDEF_WIN32_LEAN_AND_MEAN
+# endif
+# include <windows.h>
+# if defined(SQRAT_UNDEF_NOMINMAX)
+#  undef NOMINMAX
+#  undef SQRAT_UNDEF_NOMINMAX
+# endif
+# if defined(SQRAT_UNDEF_WIN32_LEAN_AND_MEAN)
+#  undef WIN32_LEAN_AND_MEAN
+#  undef SQRAT_UNDEF_WIN32_LEAN_AND_MEAN
+# endif
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+namespace Sqrat {
+
+// Layout of a bytecode image: header, index entries, names, closures serialized with sq_writeclosure
+struct BytecodeImageFormat {
+    struct Header {
+        uint32_t magic;
+        uint32_t format;
+        int64_t quirrelVersion;
+        uint32_t charSize;
+        uint32_t integerSize;
+        uint32_t floatSize;
+        uint32_t count;
+        uint64_t constHash;    ///< BytecodeKey::Constants() of the VM the scripts were compiled in
+        uint32_t compileFlags; ///< BytecodeKey::Flags
+        uint32_t reserved;
+
+        static Header Make(uint32_t count, uint64_t consts, uint32_t flags) {
+            Header h;
+            memset(&h, 0, sizeof(h));
+            h.magic = 0x49525153; // "SQRI"
+            h.format = 2;
+            h.quirrelVersion = sq_getversion();
+            h.charSize = sizeof(SQChar);
+            h.integerSize = sizeof(SQInteger);
+            h.floatSize = sizeof(SQFloat);
+            h.count = count;
+            h.constHash = consts;
+            h.compileFlags = flags;
+            return h;
+        }
+    };
+
+    struct IndexEntry {
+        uint64_t nameOffset;
+        uint64_t nameLength; ///< In characters
+        uint64_t dataOffset;
+        uint64_t dataSize;
+    };
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Builds a bytecode image file from many scripts
+///
+/// \remarks
+/// The compiler inlines constants, so the image records the const table digest of the VM its scripts are compiled in
+/// and can only be loaded into VMs with the same constants; all scripts must come from VMs with the same constants.
+/// Closures added with AddClosure() and AddSerialized() must be compiled with the debug info option of the writer.
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class BytecodeImageWriter {
+public:
+    /// \param withDebugInfo Compile with line information (sq_enabledebuginfo)
+    explicit BytecodeImageWriter(bool withDebugInfo = false) : debugInfo(withDebugInfo), consts(0), haveConsts(false) {}
+
+    /// Compiles a script and adds it to the image under the given name
+    bool AddString(HSQUIRRELVM vm, const string_view& name, const string_view& source, string& errMsg) {
+        string sourceName(name.data(), name.size());
+        if (!CheckConstants(vm)) {
+            errMsg = _SC("constants differ from the ones of the scripts already in the image");
+            return false;
+        }
+        sq_enabledebuginfo(vm, debugInfo);
+        if (SQ_FAILED(sq_compilebuffer(vm, source.data(), static_cast<SQInteger>(source.size()), sourceName.c_str(), true))) {
+            errMsg = LastErrorString(vm);
+            return false;
+        }
+        bool ok = AddClosure(vm, sourceName);
+        sq_pop(vm, 1); // pop closure
+        return ok;
+    }
+
+    /// Adds the closure on top of the stack to the image under the given name (the closure is not popped)
+    bool AddClosure(HSQUIRRELVM vm, const string& name) {
+        if (!CheckConstants(vm))
+            return false;
+        Item item;
+        item.name = name;
+        if (SQ_FAILED(sq_writeclosure(vm, &WriteFunc, &item.data)))
+            return false;
+        items.push_back(SQRAT_STD::move(item));
+        return true;
+    }
+
+    /// Adds already serialized closure data (from sq_writeclosure) under the given name
+    ///
+    /// \remarks
+    /// The closure must have been compiled in a VM with the same constants as the other scripts; if it is the first
+    /// script, call SetConstants() with that VM.
+    void AddSerialized(const string& name, const char* data, size_t size) {
+        Item item;
+        item.name = name;
+        item.data.assign(data, data + size);
+        items.push_back(SQRAT_STD::move(item));
+    }
+
+    /// Records the constants of a VM for the image, returns false if scripts from other constants were added
+    bool SetConstants(HSQUIRRELVM vm) {
+        return CheckConstants(vm);
+    }
+
+    SQInteger Size() const { return static_cast<SQInteger>(items.size()); }
+
+    /// Writes the image file
+    bool Save(const string& path) const {
+#if defined(SQUNICODE)
+        (void)path;
+        return false;
+#else
+        typedef BytecodeImageFormat::IndexEntry IndexEntry;
+        BytecodeImageFormat::Header header = BytecodeImageFormat::Header::Make(static_cast<uint32_t>(items.size()), consts,
+                                                                               debugInfo ? BytecodeKey::DebugInfo : 0);
+
+        SQRAT_STD::vector<IndexEntry> index(items.size());
+        uint64_t offset = sizeof(header) + sizeof(IndexEntry) * items.size();
+        for (size_t i = 0; i < items.size(); ++i) {
+            index[i].nameOffset = offset;
+            index[i].nameLength = items[i].name.size();
+            offset += items[i].name.size() * sizeof(SQChar);
+        }
+        for (size_t i = 0; i < items.size(); ++i) {
+            offset = (offset + 7) & ~uint64_t(7);
+            index[i].dataOffset = offset;
+            index[i].dataSize = items[i].data.size();
+            offset += items[i].data.size();
+        }
+
+        FILE* f = fopen(path.c_str(), "wb");
+        if (!f)
+            return false;
+        bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+        if (!index.empty())
+            ok = ok && fwrite(index.data(), sizeof(IndexEntry), index.size(), f) == index.size();
+        for (const Item& item : items)
+            ok = ok && fwrite(item.name.data(), sizeof(SQChar), item.name.size(), f) == item.name.size();
+        for (size_t i = 0; i < items.size() && ok; ++i) {
+            static const char padding[8] = {};
+            size_t pad = size_t(index[i].dataOffset - uint64_t(ftell(f)));
+            ok = fwrite(padding, 1, pad, f) == pad &&
+                 fwrite(items[i].data.data(), 1, items[i].data.size(), f) == items[i].data.size();
+        }
+        ok = fclose(f) == 0 && ok;
+        return ok;
+#endif
+    }
+
+private:
+    struct Item {
+        string name;
+        SQRAT_STD::vector<char> data;
+    };
+
+    bool CheckConstants(HSQUIRRELVM vm) {
+        const uint64_t digest = BytecodeKey::Constants(vm);
+        if (haveConsts)
+            return digest == consts;
+        consts = digest;
+        haveConsts = true;
+        return true;
+    }
+
+    static SQInteger WriteFunc(SQUserPointer up, SQUserPointer buf, SQInteger size) {
+        SQRAT_STD::vector<char>* data = static_cast<SQRAT_STD::vector<char>*>(up);
+        const char* p = static_cast<const char*>(buf);
+        data->insert(data->end(), p, p + size);
+        return size;
+    }
+
+    SQRAT_STD::vector<Item> items;
+    bool debugInfo;
+    uint64_t consts;
+    bool haveConsts;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Memory mapped bytecode image
+///
+/// \remarks
+/// Opening an image only maps the file and reads its index; closures are deserialized one by one when requested
+/// (Script::LoadFromImage() does it on the first Run()), so startup cost depends on the scripts actually used.
+/// The image must be kept alive while scripts may still be materialized from it. Its scripts have the constants of
+/// the VM they were compiled in inlined, so they may only be materialized in VMs with the same constants: see
+/// IsCompatible(), which Open(path, vm) and Script::LoadFromImage() check.
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class BytecodeImage {
+public:
+    /// Maps an image file, returns null if it can't be mapped or was built by an incompatible Quirrel
+    static shared_ptr<BytecodeImage> Open(const string& path) {
+        shared_ptr<BytecodeImage> image(new BytecodeImage());
+        if (!image->Map(path) || !image->ReadIndex())
+            return shared_ptr<BytecodeImage>();
+        return image;
+    }
+
+    /// Maps an image file, returns null if it can't be mapped or can't be used in the given VM
+    static shared_ptr<BytecodeImage> Open(const string& path, HSQUIRRELVM vm) {
+        shared_ptr<BytecodeImage> image = Open(path);
+        if (image && !image->IsCompatible(vm))
+            return shared_ptr<BytecodeImage>();
+        return image;
+    }
+
+    /// True if the constants of the VM are the ones the scripts were compiled with
+    bool IsCompatible(HSQUIRRELVM vm) const {
+        return BytecodeKey::Constants(vm) == constHash;
+    }
+
+    /// True if the scripts were compiled with line information
+    bool HasDebugInfo() const { return (compileFlags & BytecodeKey::DebugInfo) != 0; }
+
+    ~BytecodeImage() {
+        Unmap();
+    }
+
+    BytecodeImage(const BytecodeImage&) = delete;
+    BytecodeImage& operator=(const BytecodeImage&) = delete;
+
+    SQInteger Size() const { return static_cast<SQInteger>(entries.size()); }
+
+    bool Contains(const string& name) const { return entries.find(name) != entries.end(); }
+
+    /// Deserializes the named closure and pushes it, returns false (pushing nothing) if it's not in the image
+    ///
+    /// \remarks
+    /// The VM is not checked, see IsCompatible().
+    bool Materialize(HSQUIRRELVM vm, const string& name) const {
+        auto it = entries.find(name);
+        if (it == entries.end())
+            return false;
+        BytecodeMemoryReader reader{base + it->second.offset, it->second.size};
+        return SQ_SUCCEEDED(sq_readclosure(vm, &BytecodeMemoryReader::Read, &reader));
+    }
+
+    /// Calls f(name) for every script in the image
+    template <class F>
+    void ForEachName(F f) const {
+        for (const auto& e : entries)
+            f(e.first);
+    }
+
+private:
+    struct Entry {
+        size_t offset;
+        size_t size;
+    };
+
+    BytecodeImage() : base(nullptr), size(0), constHash(0), compileFlags(0) {
+#if defined(_WIN32)
+        file = INVALID_HANDLE_VALUE;
+        mapping = NULL;
+#endif
+    }
+
+    bool ReadIndex() {
+        typedef BytecodeImageFormat::IndexEntry IndexEntry;
+        BytecodeImageFormat::Header header;
+        if (size < sizeof(header))
+            return false;
+        memcpy(&header, base, sizeof(header));
+        BytecodeImageFormat::Header expected = BytecodeImageFormat::Header::Make(header.count, header.constHash,
+                                                                                 header.compileFlags);
+        if (memcmp(&header, &expected, sizeof(header)) != 0)
+            return false;
+        constHash = header.constHash;
+        compileFlags = header.compileFlags;
+        if ((size - sizeof(header)) / sizeof(IndexEntry) < header.count)
+            return false;
+
+        entries.reserve(header.count);
+        for (uint32_t i = 0; i < header.count; ++i) {
+            IndexEntry e;
+            memcpy(&e, base + sizeof(header) + i * sizeof(IndexEntry), sizeof(e));
+            if (e.nameOffset > size || e.nameLength > (size - e.nameOffset) / sizeof(SQChar) ||
+                e.dataOffset > size || e.dataSize > size - e.dataOffset)
+                return false;
+            string name(e.nameLength, SQChar(0));
+            memcpy(&name[0], base + e.nameOffset, size_t(e.nameLength) * sizeof(SQChar));
+            entries[name] = Entry{size_t(e.dataOffset), size_t(e.dataSize)};
+        }
+        return true;
+    }
+
+#if defined(_WIN32)
+    bool Map(const string& path) {
+# if defined(SQUNICODE)
+        file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+# else
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+# endif
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+            return false;
+        mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping)
+            return false;
+        base = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        size = size_t(fileSize.QuadPart);
+        return base != nullptr;
+    }
+
+    void Unmap() {
+        if (base)
+            UnmapViewOfFile(base);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+    }
+
+    HANDLE file;
+    HANDLE mapping;
+#else
+    bool Map(const string& path) {
+# if defined(SQUNICODE)
+        (void)path;
+        return false;
+# else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            return false;
+        }
+        void* p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd); // the mapping keeps the file
+        if (p == MAP_FAILED)
+            return false;
+        base = static_cast<const char*>(p);
+        size = size_t(st.st_size);
+        return true;
+# endif
+    }
+
+    void Unmap() {
+        if (base)
+            munmap(const_cast<char*>(base), size);
+    }
+#endif
+
+    const char* base;
+    size_t size;
+    uint64_t constHash;
+    uint32_t compileFlags;
+    SQRAT_STD::unordered_map<string, Entry> entries;
+};
+
+}
+
+#endif
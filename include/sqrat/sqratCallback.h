@@ -0,0 +1,194 @@
+// Sqrat: altered version by Gaijin Entertainment Corp.
+// sqratCallback: Native callbacks calling Quirrel functions
+//
+
+//
+// Copyright (c) 2009 Brandon Jones
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//  claim that you wrote the original software. If you use this software
+//  in a product, an acknowledgment in the product documentation would be
+//  appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//  misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source
+//  distribution.
+//
+
+
+#pragma once
+#if !defined(_SQRAT_CALLBACK_H_)
+#define _SQRAT_CALLBACK_H_
+
+#include <squirrel.h>
+
+#include "sqratFunction.h"
+#include "sqratGlobalMethods.h"
+#include "sqratPreparedCall.h"
+#include "sqratTypes.h"
+#include "sqratUtil.h"
+
+#if defined(SQRAT_HAS_EASTL)
+# include <EASTL/functional.h>
+#else
+# include <functional>
+#endif
+
+namespace Sqrat {
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Move-only handle to a Quirrel function that native code can keep and call later (timers, physics callbacks, ...)
+///
+/// \tparam Sig Signature of the call, R(Args...)
+///
+/// \remarks
+/// Calls go through PreparedCall. Bound native functions receive a Callback by reference (Callback<Sig>&) and move it
+/// to where it is stored.
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <class Sig>
+class Callback : public PreparedCall<Sig> {
+public:
+    Callback() {}
+    explicit Callback(const Function& f, bool checkArity = true) : PreparedCall<Sig>(f, checkArity) {}
+
+    Callback(const Callback&) = delete;
+    Callback& operator=(const Callback&) = delete;
+    Callback(Callback&&) = default;
+    Callback& operator=(Callback&&) = default;
+
+    explicit operator bool() const { return this->IsValid(); }
+};
+
+
+template <class Sig>
+struct is_script_callable_handle<Callback<Sig>> : SQRAT_STD::true_type {};
+
+template <class Sig>
+struct is_script_callable_handle<SQRAT_STD::function<Sig>> : SQRAT_STD::true_type {};
+
+
+/// Callable stored in std::function objects created from Quirrel functions
+template <class Sig>
+class ScriptFunctionInvoker;
+
+template <class R, class... Args>
+class ScriptFunctionInvoker<R(Args...)> {
+public:
+    explicit ScriptFunctionInvoker(const Function& f) : call(f, false) {}
+
+    R operator()(Args... args) const {
+        return static_cast<R>(call(args...));
+    }
+
+    const Function& GetFunction() const { return call.GetFunction(); }
+
+private:
+    PreparedCall<R(Args...)> call;
+};
+
+
+/// Common part of Var specializations for Callback and std::function
+struct ScriptCallableVarBase {
+    static const SQChar * getVarTypeName() { return _SC("closure"); }
+    static bool check_type(HSQUIRRELVM vm, SQInteger idx) {
+        return Var<Function>::check_type(vm, idx);
+    }
+};
+
+
+/// Used to get Callback from the stack and push it back as the original closure
+template <class Sig>
+struct Var<Callback<Sig>> : ScriptCallableVarBase {
+
+    Callback<Sig> value; ///< The actual value of get operations
+
+    /// Attempts to get the value off the stack at idx as a Callback (null gives an empty Callback)
+    Var(HSQUIRRELVM vm, SQInteger idx) {
+        if (sq_gettype(vm, idx) != OT_NULL)
+            value = Callback<Sig>(Var<Function>(vm, idx).value, false);
+    }
+
+    /// Called by Sqrat::PushVar to put a Callback on the stack
+    static void push(HSQUIRRELVM vm, const Callback<Sig>& value) {
+        if (value.IsValid())
+            sq_pushobject(vm, value.GetFunction().GetFunc());
+        else
+            sq_pushnull(vm);
+    }
+};
+
+template <class Sig>
+struct Var<Callback<Sig>&> : Var<Callback<Sig>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<Callback<Sig>>(vm, idx) {}
+};
+
+template <class Sig>
+struct Var<const Callback<Sig>&> : Var<Callback<Sig>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<Callback<Sig>>(vm, idx) {}
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Used to get std::function from the stack and push it to the stack
+///
+/// \remarks
+/// A Quirrel closure read as std::function is called through PreparedCall, and pushing such std::function back gives
+/// the original closure. Other std::function objects are pushed as native closures, like any other callable.
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <class R, class... Args>
+struct Var<SQRAT_STD::function<R(Args...)>> : ScriptCallableVarBase {
+    typedef SQRAT_STD::function<R(Args...)> Func;
+
+    Func value; ///< The actual value of get operations
+
+    /// Attempts to get the value off the stack at idx as std::function (null gives an empty function)
+    Var(HSQUIRRELVM vm, SQInteger idx) {
+        if (sq_gettype(vm, idx) != OT_NULL)
+            value = ScriptFunctionInvoker<R(Args...)>(Var<Function>(vm, idx).value);
+    }
+
+    /// Called by Sqrat::PushVar to put std::function on the stack
+    static void push(HSQUIRRELVM vm, const Func& value) {
+        if (!value) {
+            sq_pushnull(vm);
+            return;
+        }
+#if !defined(SQRAT_HAS_EASTL) || EASTL_RTTI_ENABLED
+        if (const ScriptFunctionInvoker<R(Args...)>* invoker = value.template target<ScriptFunctionInvoker<R(Args...)>>()) {
+            sq_pushobject(vm, invoker->GetFunction().GetFunc());
+            return;
+        }
+#endif
+        SQFUNCTION funcThunk = SqGlobalThunk<Func>();
+        SQUserPointer funcPtr = sq_newuserdata(vm, sizeof(Func));
+        new (funcPtr) Func(value);
+        sq_setreleasehook(vm, -1, ImplaceFreeReleaseHook<Func>);
+        sq_newclosure(vm, funcThunk, 1);
+    }
+};
+
+template <class R, class... Args>
+struct Var<SQRAT_STD::function<R(Args...)>&> : Var<SQRAT_STD::function<R(Args...)>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<SQRAT_STD::function<R(Args...)>>(vm, idx) {}
+};
+
+template <class R, class... Args>
+struct Var<const SQRAT_STD::function<R(Args...)>&> : Var<SQRAT_STD::function<R(Args...)>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<SQRAT_STD::function<R(Args...)>>(vm, idx) {}
+};
+
+}
+
+#endif
@@ -0,0 +1,293 @@
+// Sqrat: altered version by Gaijin Entertainment Corp.
+// sqratChannel: Message channel between VMs
+//
+
+//
+// Copyright (c) 2009 Brandon Jones
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//  claim that you wrote the original software. If you use this software
+//  in a product, an acknowledgment in the product documentation would be
+//  appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//  misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source
+//  distribution.
+//
+
+
+
+#pragma once
+#if !defined(_SQRAT_CHANNEL_H_)
+#define _SQRAT_CHANNEL_H_
+
+#include <squirrel.h>
+
+#include "sqratObject.h"
+#include "sqratSerialize.h"
+#include "sqratUtil.h"
+
+#if defined(SQRAT_HAS_EASTL)
+# include <EASTL/functional.h>
+# include <EASTL/vector.h>
+#else
+# include <functional>
+# include <vector>
+#endif
+
+#include <atomic>
+
+namespace Sqrat {
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Channel moving script values from any number of VMs to one receiving VM, possibly across threads
+///
+/// \remarks
+/// Values are serialized by the sender (see Serializer) and queued as byte payloads in a lock-free multiple
+/// producer, single consumer queue; nothing is shared between the VMs. The receiver takes payloads without decoding
+/// them and decodes values into its VM only when it reads them. A Batch sends several values as one payload,
+/// writing each distinct string and shared object only once for the whole batch.
+///
+/// Send() and Batch may be used from any thread; Receive() and Drain() from one thread at a time.
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class Channel {
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        SQRAT_STD::vector<unsigned char> data;
+        size_t count = 0; ///< Values in data
+    };
+
+public:
+    struct Stats {
+        SQInteger payloads = 0; ///< Payloads sent
+        SQInteger values = 0;   ///< Values sent
+        SQInteger bytes = 0;    ///< Serialized bytes sent
+    };
+
+    /// Received payload whose values are decoded on demand
+    class Message {
+    public:
+        Message() {}
+
+        size_t GetValueCount() const { return node ? node->count : 0; }
+        size_t GetByteSize() const { return node ? node->data.size() : 0; }
+        bool AtEnd() const { return read == GetValueCount(); }
+
+        /// True if a Read() failed; the position in the data is lost then, so all later reads fail too
+        bool IsFailed() const { return failed; }
+
+        /// Decodes the next value onto the stack, returns false at the end or on malformed data (see GetError)
+        bool Read(HSQUIRRELVM vm) {
+            if (failed || AtEnd())
+                return false;
+            if (!reader)
+                reader.reset(new Deserializer(node->data.data(), node->data.size(), registry));
+            if (!reader->Read(vm)) {
+                failed = true;
+                return false;
+            }
+            ++read;
+            return true;
+        }
+
+        /// Decodes the next value into an Object
+        bool Read(HSQUIRRELVM vm, Object& out) {
+            if (!Read(vm))
+                return false;
+            HSQOBJECT o;
+            sq_getstackobj(vm, -1, &o);
+            out = Object(o, vm);
+            sq_pop(vm, 1); // pop value
+            return true;
+        }
+
+        const string& GetError() const {
+            static const string none;
+            return reader ? reader->GetError() : none;
+        }
+
+    private:
+        friend class Channel;
+
+        SQRAT_STD::shared_ptr<Node> node;
+        SQRAT_STD::shared_ptr<Deserializer> reader; ///< Created on first read, keeps the strings and objects of the batch
+        const SerializationRegistry* registry = nullptr;
+        size_t read = 0;
+        bool failed = false;
+    };
+
+    /// Values sent together as one payload, sharing strings and objects
+    ///
+    /// \remarks
+    /// Adding temporaries (e.g. Object values dropped right after Add) is safe only because the Serializer keeps
+    /// every written object referenced until Send(); otherwise a freed object's address could be reused by a later
+    /// value and written as a reference to the earlier one. The references are released by Send() or destruction.
+    class Batch {
+    public:
+        explicit Batch(Channel& ch) : channel(ch), writer(ch.registry), count(0) {}
+
+        /// Adds the value at the given stack index, returns false (see GetError) if it can't be serialized
+        bool Add(HSQUIRRELVM vm, SQInteger idx) {
+            if (!writer.Write(vm, idx))
+                return false;
+            ++count;
+            return true;
+        }
+
+        bool Add(const Object& value) {
+            if (!writer.Write(value))
+                return false;
+            ++count;
+            return true;
+        }
+
+        size_t GetCount() const { return count; }
+        const string& GetError() const { return writer.GetError(); }
+
+        /// Queues the values added so far and starts a new batch; nothing is sent if the batch is empty
+        void Send() {
+            if (count == 0)
+                return;
+            Node* n = new Node();
+            n->data = writer.Release();
+            n->count = count;
+            channel.Push(n);
+            count = 0;
+        }
+
+    private:
+        Channel& channel;
+        Serializer writer;
+        size_t count;
+    };
+
+    explicit Channel(const SerializationRegistry* classes = nullptr) : registry(classes), head(&stub), tail(&stub) {}
+
+    Channel(const Channel&) = delete;
+    Channel& operator=(const Channel&) = delete;
+
+    ~Channel() {
+        Message m;
+        while (Receive(m))
+            ;
+    }
+
+    /// Sends one value, returns false (filling errMsg if given) if it can't be serialized
+    bool Send(const Object& value, string* errMsg = nullptr) {
+        Batch b(*this);
+        if (!b.Add(value)) {
+            if (errMsg)
+                *errMsg = b.GetError();
+            return false;
+        }
+        b.Send();
+        return true;
+    }
+
+    /// Takes the next payload without decoding it, returns false if the channel is empty
+    bool Receive(Message& msg) {
+        Node* n = Pop();
+        if (!n)
+            return false;
+        msg.node.reset(n);
+        msg.reader.reset();
+        msg.registry = registry;
+        msg.read = 0;
+        msg.failed = false;
+        return true;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Decodes every pending value into a VM and passes it to a handler
+    ///
+    /// \param vm      Receiving VM
+    /// \param handler Called with each value, in sending order per sender
+    ///
+    /// \return Number of values handled (payloads with malformed data are skipped from the bad value on)
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    size_t Drain(HSQUIRRELVM vm, const SQRAT_STD::function<void(const Object&)>& handler) {
+        size_t handled = 0;
+        Message m;
+        while (Receive(m)) {
+            Object value;
+            while (m.Read(vm, value)) {
+                handler(value);
+                ++handled;
+            }
+        }
+        return handled;
+    }
+
+    Stats GetStats() const {
+        Stats s;
+        s.payloads = payloads.load(std::memory_order_relaxed);
+        s.values = values.load(std::memory_order_relaxed);
+        s.bytes = bytes.load(std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    // Intrusive MPSC queue (Vyukov): producers exchange the head, the consumer follows next pointers from the tail
+
+    void Push(Node* n) {
+        payloads.fetch_add(1, std::memory_order_relaxed);
+        values.fetch_add(SQInteger(n->count), std::memory_order_relaxed);
+        bytes.fetch_add(SQInteger(n->data.size()), std::memory_order_relaxed);
+        Link(n);
+    }
+
+    void Link(Node* n) {
+        n->next.store(nullptr, std::memory_order_relaxed);
+        Node* prev = head.exchange(n, std::memory_order_acq_rel);
+        prev->next.store(n, std::memory_order_release);
+    }
+
+    Node* Pop() {
+        Node* t = tail;
+        Node* next = t->next.load(std::memory_order_acquire);
+        if (t == &stub) {
+            if (!next)
+                return nullptr;
+            tail = next;
+            t = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next) {
+            tail = next;
+            return t;
+        }
+        if (t != head.load(std::memory_order_acquire))
+            return nullptr; // a producer is linking a node, it will be visible shortly
+        Link(&stub);
+        next = t->next.load(std::memory_order_acquire);
+        if (next) {
+            tail = next;
+            return t;
+        }
+        return nullptr;
+    }
+
+    const SerializationRegistry* registry;
+    Node stub;
+    std::atomic<Node*> head;
+    Node* tail;
+    std::atomic<SQInteger> payloads{0};
+    std::atomic<SQInteger> values{0};
+    std::atomic<SQInteger> bytes{0};
+};
+
+}
+
+#endif
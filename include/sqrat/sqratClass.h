@@ -103,16 +103,13 @@ public:
 
             ClassData<C>* cd = *ud;
 
-            if (ClassType<C>::getStaticClassData().expired()) {
-                cd->staticData.reset(new StaticClassData<C, void>);
-                cd->staticData->copyFunc  = &A::Copy;
-                cd->staticData->className = SQRAT_STD::move(className);
-                cd->staticData->baseClass = NULL;
-
-                ClassType<C>::getStaticClassData() = cd->staticData;
-            } else {
-                cd->staticData = ClassType<C>::getStaticClassData().lock();
-            }
+            cd->staticData = ClassType<C>::getOrCreateStaticClassData([&className]() {
+                shared_ptr<AbstractStaticClassData> staticData(new StaticClassData<C, void>);
+                staticData->copyFunc  = &A::Copy;
+                staticData->className = SQRAT_STD::move(className);
+                staticData->baseClass = NULL;
+                return staticData;
+            });
 
             HSQOBJECT& classObj = cd->classObj;
             sq_resetobject(&classObj);
@@ -640,16 +637,13 @@ public:
             ClassData<B>* bd = ClassType<B>::getClassData(v);
             ClassData<C>* cd = *ud;
 
-            if (ClassType<C>::getStaticClassData().expired()) {
-                cd->staticData.reset(new StaticClassData<C, B>);
-                cd->staticData->copyFunc  = &A::Copy;
-                cd->staticData->className = SQRAT_STD::move(className);
-                cd->staticData->baseClass = bd->staticData.get();
-
-                ClassType<C>::getStaticClassData() = cd->staticData;
-            } else {
-                cd->staticData = ClassType<C>::getStaticClassData().lock();
-            }
+            cd->staticData = ClassType<C>::getOrCreateStaticClassData([&className, bd]() {
+                shared_ptr<AbstractStaticClassData> staticData(new StaticClassData<C, B>);
+                staticData->copyFunc  = &A::Copy;
+                staticData->className = SQRAT_STD::move(className);
+                staticData->baseClass = bd->staticData.get();
+                return staticData;
+            });
 
             HSQOBJECT& classObj = cd->classObj;
             sq_resetobject(&classObj);
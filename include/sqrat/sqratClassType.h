@@ -32,6 +32,9 @@
 #include <squirrel.h>
 #include "sqratUtil.h"
 
+#include <atomic>
+#include <mutex>
+
 namespace Sqrat
 {
 
@@ -41,27 +44,153 @@ typedef SQInteger (*COPYFUNC)(HSQUIRRELVM, SQInteger, const void*);
 
 struct AbstractStaticClassData;
 
+// Registry entry of a C++ class: the static data shared by all VMs that bound the class
+struct StaticClassDataSlot {
+    weak_ptr<AbstractStaticClassData> data;                 // guarded by the registry mutex
+    std::atomic<AbstractStaticClassData*> raw{nullptr};     // same object for lock-free reads, cleared when it dies
+};
+
+// Set of live AbstractStaticClassData pointers: lookups are lock-free, insert and erase are done under the registry mutex.
+// Open addressing with tombstones. When live entries and tombstones fill half the table it is rebuilt from the live
+// entries only, growing if needed. Lookups are plain acquire loads and may still probe a replaced table, so replaced
+// tables are kept until exit. A table is built at most a quarter full, so replacing it takes a quarter of its capacity
+// in inserts: kept tables add up to a few slots per class data ever created. Nothing is freed at exit either, since
+// class data in other translation units may still erase itself afterwards.
+class ClassPointerSet {
+public:
+    bool contains(const AbstractStaticClassData* p) const {
+        Table* t = table.load(std::memory_order_acquire);
+        if (!t || !p)
+            return false;
+        for (size_t i = hash(p) & t->mask;; i = (i + 1) & t->mask) {
+            AbstractStaticClassData* s = t->slots[i].load(std::memory_order_acquire);
+            if (s == p)
+                return true;
+            if (!s)
+                return false;
+        }
+    }
+
+    void insert(AbstractStaticClassData* p) {
+        Table* t = table.load(std::memory_order_relaxed);
+        if (!t || (t->used + 1) * 2 > t->mask + 1)
+            t = rebuild(t);
+        std::atomic<AbstractStaticClassData*>* free = nullptr;
+        for (size_t i = hash(p) & t->mask;; i = (i + 1) & t->mask) {
+            AbstractStaticClassData* s = t->slots[i].load(std::memory_order_relaxed);
+            if (s == p)
+                return;
+            if (s == tombstone() && !free)
+                free = &t->slots[i];
+            if (!s) {
+                if (!free) {
+                    free = &t->slots[i];
+                    ++t->used;
+                }
+                break;
+            }
+        }
+        free->store(p, std::memory_order_release);
+        ++t->live;
+    }
+
+    void erase(AbstractStaticClassData* p) {
+        Table* t = table.load(std::memory_order_relaxed);
+        if (!t)
+            return;
+        for (size_t i = hash(p) & t->mask;; i = (i + 1) & t->mask) {
+            AbstractStaticClassData* s = t->slots[i].load(std::memory_order_relaxed);
+            if (!s)
+                return;
+            if (s == p) {
+                t->slots[i].store(tombstone(), std::memory_order_release);
+                --t->live;
+                return;
+            }
+        }
+    }
+
+private:
+    struct Table {
+        size_t mask;
+        size_t used; // live entries and tombstones
+        size_t live;
+        std::atomic<AbstractStaticClassData*>* slots;
+        Table* next; // in the list of replaced tables
+    };
+
+    static AbstractStaticClassData* tombstone() { return reinterpret_cast<AbstractStaticClassData*>(uintptr_t(1)); }
+    static size_t hash(const AbstractStaticClassData* p) { return size_t((uint64_t(uintptr_t(p)) >> 3) * 0x9E3779B97F4A7C15ull >> 16); }
+
+    Table* rebuild(Table* old) {
+        size_t live = old ? old->live : 0;
+        size_t capacity = 64;
+        while (capacity < (live + 1) * 4)
+            capacity *= 2;
+        Table* t = new Table;
+        t->mask = capacity - 1;
+        t->used = 0;
+        t->live = 0;
+        t->next = nullptr;
+        t->slots = new std::atomic<AbstractStaticClassData*>[capacity];
+        for (size_t i = 0; i < capacity; ++i)
+            t->slots[i].store(nullptr, std::memory_order_relaxed);
+        if (old) {
+            for (size_t i = 0; i <= old->mask; ++i) {
+                AbstractStaticClassData* s = old->slots[i].load(std::memory_order_relaxed);
+                if (s && s != tombstone()) {
+                    size_t j = hash(s) & t->mask;
+                    while (t->slots[j].load(std::memory_order_relaxed))
+                        j = (j + 1) & t->mask;
+                    t->slots[j].store(s, std::memory_order_relaxed);
+                    ++t->used;
+                    ++t->live;
+                }
+            }
+            old->next = retired;
+            retired = old;
+        }
+        table.store(t, std::memory_order_release);
+        return t;
+    }
+
+    std::atomic<Table*> table{nullptr};
+    Table* retired = nullptr; // replaced tables, guarded by the registry mutex
+};
+
 // Lookup static class data by type_info rather than a template because C++ cannot export generic templates
 struct IntPtrHash { size_t operator()(const void *p) const { return uintptr_t(p) >> 2; } };
 template <typename T = void> // dummy template for static var (in-function static generates ineffective, useless for us, thread-safe code)
 class _ClassType_helper
 {
 public:
-    static class_hash_map<const void*, weak_ptr<AbstractStaticClassData>, IntPtrHash> data;
-    static weak_ptr<AbstractStaticClassData>& _getStaticClassData(const void* type) { return data[type]; }
-    static SQRAT_STD::unordered_set<AbstractStaticClassData*> all_classes;
+    // Registration (and anything touching data or the weak pointers in the slots) is done under this mutex
+    static std::mutex mutex;
+    static class_hash_map<const void*, StaticClassDataSlot*, IntPtrHash> data; // slots are never freed
+    static StaticClassDataSlot& _getSlot(const void* type) {
+        std::lock_guard<std::mutex> lock(mutex);
+        StaticClassDataSlot*& slot = data[type];
+        if (!slot)
+            slot = new StaticClassDataSlot;
+        return *slot;
+    }
+    static ClassPointerSet all_classes;
 };
 template<typename T>
-class_hash_map<const void*, weak_ptr<AbstractStaticClassData>, IntPtrHash> _ClassType_helper<T>::data;
+std::mutex _ClassType_helper<T>::mutex;
+
+template<typename T>
+class_hash_map<const void*, StaticClassDataSlot*, IntPtrHash> _ClassType_helper<T>::data;
 
 template<typename T>
-SQRAT_STD::unordered_set<AbstractStaticClassData*> _ClassType_helper<T>::all_classes;
+ClassPointerSet _ClassType_helper<T>::all_classes;
 
 
 
 // Every Squirrel class instance made by Sqrat has its type tag set to a AbstractStaticClassData object that is unique per C++ class
 struct AbstractStaticClassData {
     AbstractStaticClassData() {
+        std::lock_guard<std::mutex> lock(_ClassType_helper<>::mutex);
         _ClassType_helper<>::all_classes.insert(this);
     }
     AbstractStaticClassData(const AbstractStaticClassData &) = delete;
@@ -69,7 +198,12 @@ struct AbstractStaticClassData {
     AbstractStaticClassData& operator=(const AbstractStaticClassData &) = delete;
     AbstractStaticClassData& operator=(AbstractStaticClassData &&) = default;
     virtual ~AbstractStaticClassData() {
+        std::lock_guard<std::mutex> lock(_ClassType_helper<>::mutex);
         _ClassType_helper<>::all_classes.erase(this);
+        if (registrySlot) {
+            AbstractStaticClassData* self = this;
+            registrySlot->raw.compare_exchange_strong(self, nullptr);
+        }
     }
     virtual SQUserPointer Cast(SQUserPointer ptr, SQUserPointer classType) = 0;
     virtual bool PushInstance(HSQUIRRELVM vm, void *ptr) = 0;
@@ -79,7 +213,7 @@ struct AbstractStaticClassData {
     }
 
     static bool isValidSqratClass(AbstractStaticClassData *asd) {
-        return _ClassType_helper<>::all_classes.find(asd) != _ClassType_helper<>::all_classes.end();
+        return _ClassType_helper<>::all_classes.contains(asd);
     }
 
     static AbstractStaticClassData* FromObject(const HSQOBJECT *obj) {
@@ -92,6 +226,7 @@ struct AbstractStaticClassData {
     AbstractStaticClassData* baseClass;
     string                   className;
     COPYFUNC                 copyFunc;
+    StaticClassDataSlot*     registrySlot = nullptr; // set once registered
 };
 
 
@@ -154,12 +289,61 @@ public:
         return *ud;
     }
 
-    static weak_ptr<AbstractStaticClassData>& getStaticClassData() {
-        return _ClassType_helper<>::_getStaticClassData(ClassData<C>::type_id());
+    // Registry slot of C, looked up once and cached
+    static StaticClassDataSlot& getSlot() {
+        StaticClassDataSlot* slot = slotCache.load(std::memory_order_acquire);
+        if (!slot) {
+            slot = &_ClassType_helper<>::_getSlot(ClassData<C>::type_id());
+            slotCache.store(slot, std::memory_order_release);
+        }
+        return *slot;
+    }
+
+    static weak_ptr<AbstractStaticClassData> getStaticClassData() {
+        StaticClassDataSlot& slot = getSlot();
+        std::lock_guard<std::mutex> lock(_ClassType_helper<>::mutex);
+        return slot.data;
+    }
+
+    // Lock-free access to the static data, null if no VM has bound the class
+    static AbstractStaticClassData* getStaticClassDataPtr() {
+        return getSlot().raw.load(std::memory_order_acquire);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Returns the static data of C, registering the one made by create() if no VM holds it
+    ///
+    /// \remarks
+    /// create() runs outside the registry mutex; if another thread registers the class first its data is returned
+    /// and the created one is dropped.
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    template<class F>
+    static shared_ptr<AbstractStaticClassData> getOrCreateStaticClassData(F create) {
+        StaticClassDataSlot& slot = getSlot();
+        {
+            std::lock_guard<std::mutex> lock(_ClassType_helper<>::mutex);
+            shared_ptr<AbstractStaticClassData> existing = slot.data.lock();
+            if (existing)
+                return existing;
+        }
+        shared_ptr<AbstractStaticClassData> created = create();
+        shared_ptr<AbstractStaticClassData> existing;
+        {
+            std::lock_guard<std::mutex> lock(_ClassType_helper<>::mutex);
+            existing = slot.data.lock();
+            if (!existing) {
+                created->registrySlot = &slot;
+                slot.data = created;
+                slot.raw.store(created.get(), std::memory_order_release);
+                return created;
+            }
+        }
+        return existing; // created is destroyed here, outside the mutex
     }
 
     static inline bool hasClassData(HSQUIRRELVM vm) {
-        if (!getStaticClassData().expired()) {
+        if (getStaticClassDataPtr()) {
             sq_pushregistrytable(vm);
             sq_pushuserpointer(vm, ClassesRegistryTable::slotKey());
             if (SQ_SUCCEEDED(sq_rawget(vm, -2))) {
@@ -176,18 +360,18 @@ public:
     }
 
     static inline AbstractStaticClassData*& BaseClass() {
-        SQRAT_ASSERT(getStaticClassData().expired() == false); // fails because called before a Sqrat::Class for this type exists
-        return getStaticClassData().lock()->baseClass;
+        SQRAT_ASSERT(getStaticClassDataPtr() != nullptr); // fails because called before a Sqrat::Class for this type exists
+        return getStaticClassDataPtr()->baseClass;
     }
 
     static inline const string& ClassName() {
-        SQRAT_ASSERT(getStaticClassData().expired() == false); // fails because called before a Sqrat::Class for this type exists
-        return getStaticClassData().lock()->className;
+        SQRAT_ASSERT(getStaticClassDataPtr() != nullptr); // fails because called before a Sqrat::Class for this type exists
+        return getStaticClassDataPtr()->className;
     }
 
     static inline COPYFUNC& CopyFunc() {
-        SQRAT_ASSERT(getStaticClassData().expired() == false); // fails because called before a Sqrat::Class for this type exists
-        return getStaticClassData().lock()->copyFunc;
+        SQRAT_ASSERT(getStaticClassDataPtr() != nullptr); // fails because called before a Sqrat::Class for this type exists
+        return getStaticClassDataPtr()->copyFunc;
     }
 
     static bool IsObjectOfClass(const HSQOBJECT *obj)
@@ -197,7 +381,7 @@ public:
             return false;
         if (!actualType || !AbstractStaticClassData::isValidSqratClass(actualType))
             return false;
-        AbstractStaticClassData* thisClass = getStaticClassData().lock().get();
+        AbstractStaticClassData* thisClass = getStaticClassDataPtr();
         for (AbstractStaticClassData *cls = actualType; cls; cls = cls->baseClass)
             if (cls == thisClass)
                 return true;
@@ -259,7 +443,7 @@ public:
                 return NULL;
             }
 
-            classType = getStaticClassData().lock().get();
+            classType = getStaticClassDataPtr();
 
             if (SQ_FAILED(sq_getinstanceup(vm, idx, (SQUserPointer*)&instance, classType))) {
                 SQRAT_ASSERTF(0, FormatTypeError(vm, idx, ClassName().c_str()).c_str());
@@ -300,7 +484,7 @@ public:
             return true;
         if (type != OT_INSTANCE)
             return false;
-        AbstractStaticClassData* classType = getStaticClassData().lock().get();
+        AbstractStaticClassData* classType = getStaticClassDataPtr();
         AbstractStaticClassData* actualType = nullptr;
         if (SQ_FAILED(sq_getobjtypetag(&ho, (SQUserPointer*)&actualType)))
             return false;
@@ -330,8 +514,14 @@ public:
         sq_pushstring(vm, str.c_str(), l);
         return 1;
     }
+
+private:
+    static std::atomic<StaticClassDataSlot*> slotCache;
 };
 
+template<class C>
+std::atomic<StaticClassDataSlot*> ClassType<C>::slotCache{nullptr};
+
 template<class C, class B> bool StaticClassData<C, B>::PushInstance(HSQUIRRELVM vm, void *ptr) {
     return ClassType<C>::PushInstance(vm, reinterpret_cast<C*>(ptr));
 }
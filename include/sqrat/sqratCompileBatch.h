@@ -0,0 +1,177 @@
+// Sqrat: altered version by Gaijin Entertainment Corp.
+// sqratCompileBatch: Parallel compilation of script files
+//
+
+//
+// Copyright (c) 2009 Brandon Jones
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//  claim that you wrote the original software. If you use this software
+//  in a product, an acknowledgment in the product documentation would be
+//  appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//  misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source
+//  distribution.
+//
+
+
+#pragma once
+#if !defined(_SQRAT_COMPILE_BATCH_H_)
+#define _SQRAT_COMPILE_BATCH_H_
+
+#include <squirrel.h>
+
+#include "sqratBytecodeCache.h"
+#include "sqratScript.h"
+#include "sqratUtil.h"
+
+#if defined(SQRAT_HAS_EASTL)
+# include <EASTL/vector.h>
+# include <EASTL/functional.h>
+#else
+# include <vector>
+# include <functional>
+#endif
+
+#include <atomic>
+#include <thread>
+
+namespace Sqrat {
+
+/// Script compiled by CompileToBytecode(), serialized with sq_writeclosure
+struct CompiledBytecode {
+    string path;
+    string errMsg;                   ///< Compiler error, empty on success
+    SQRAT_STD::vector<char> bytecode;
+
+    bool IsOk() const { return errMsg.empty(); }
+};
+
+/// Script compiled and loaded by CompileBatch()
+struct CompiledScript {
+    explicit CompiledScript(HSQUIRRELVM vm) : script(vm) {}
+
+    string path;
+    string errMsg; ///< Compiler or loading error, empty on success
+    Script script;
+
+    bool IsOk() const { return errMsg.empty(); }
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Compiles script files in parallel, producing serialized bytecode
+///
+/// \param paths    Files to compile
+/// \param threads  Number of worker threads (0 uses the number of hardware threads)
+/// \param setupVm  Optional function preparing every scratch VM (e.g. registering constants the scripts refer to,
+///                 since constants are resolved at compile time)
+///
+/// \remarks
+/// Every worker owns a scratch VM (sq_open), so workers share nothing. The results can be loaded into any VM
+/// compatible with this build of Quirrel, or packed with BytecodeImageWriter::AddSerialized().
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline SQRAT_STD::vector<CompiledBytecode> CompileToBytecode(const SQRAT_STD::vector<string>& paths, unsigned threads = 0,
+                                                            const SQRAT_STD::function<void(HSQUIRRELVM)>& setupVm = nullptr)
+{
+    SQRAT_STD::vector<CompiledBytecode> results(paths.size());
+    if (paths.empty())
+        return results;
+
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+    if (threads > paths.size())
+        threads = static_cast<unsigned>(paths.size());
+
+    struct Writer {
+        static SQInteger Write(SQUserPointer up, SQUserPointer buf, SQInteger size) {
+            SQRAT_STD::vector<char>* data = static_cast<SQRAT_STD::vector<char>*>(up);
+            const char* p = static_cast<const char*>(buf);
+            data->insert(data->end(), p, p + size);
+            return size;
+        }
+    };
+
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        HSQUIRRELVM vm = sq_open(1024);
+        if (setupVm)
+            setupVm(vm);
+        string source;
+        for (size_t i = next++; i < paths.size(); i = next++) {
+            CompiledBytecode& r = results[i];
+            r.path = paths[i];
+            if (!BytecodeCache::ReadFile(paths[i], source)) {
+                r.errMsg = _SC("cannot read file");
+                continue;
+            }
+            SQInteger top = sq_gettop(vm);
+            if (SQ_FAILED(sq_compilebuffer(vm, source.data(), static_cast<SQInteger>(source.size()), paths[i].c_str(), SQFalse)))
+                r.errMsg = LastErrorString(vm);
+            else if (SQ_FAILED(sq_writeclosure(vm, &Writer::Write, &r.bytecode)))
+                r.errMsg = _SC("cannot serialize closure");
+            sq_settop(vm, top);
+        }
+        sq_close(vm);
+    };
+
+    SQRAT_STD::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; ++i)
+        pool.emplace_back(worker);
+    worker(); // the calling thread works too
+    for (std::thread& t : pool)
+        t.join();
+    return results;
+}
+
+/// Deserializes bytecode produced by CompileToBytecode() into a Script
+inline bool LoadBytecode(Script& script, const CompiledBytecode& compiled, string& errMsg) {
+    if (!compiled.IsOk()) {
+        errMsg = compiled.errMsg;
+        return false;
+    }
+
+    return script.LoadBytecode(compiled.bytecode.data(), compiled.bytecode.size(), errMsg);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Compiles script files in parallel and loads them into a VM
+///
+/// \param vm       VM the scripts are loaded into (sequentially, on the calling thread)
+/// \param paths    Files to compile
+/// \param threads  Number of worker threads (0 uses the number of hardware threads)
+/// \param setupVm  Optional function preparing every scratch VM, see CompileToBytecode()
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline SQRAT_STD::vector<CompiledScript> CompileBatch(HSQUIRRELVM vm, const SQRAT_STD::vector<string>& paths, unsigned threads = 0,
+                                                      const SQRAT_STD::function<void(HSQUIRRELVM)>& setupVm = nullptr)
+{
+    SQRAT_STD::vector<CompiledBytecode> compiled = CompileToBytecode(paths, threads, setupVm);
+    SQRAT_STD::vector<CompiledScript> scripts;
+    scripts.reserve(compiled.size());
+    for (const CompiledBytecode& c : compiled) {
+        scripts.emplace_back(vm);
+        CompiledScript& s = scripts.back();
+        s.path = c.path;
+        LoadBytecode(s.script, c, s.errMsg);
+    }
+    return scripts;
+}
+
+}
+
+#endif
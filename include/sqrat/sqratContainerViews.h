@@ -0,0 +1,530 @@
+// Sqrat: altered version by Gaijin Entertainment Corp.
+// SqratContainerViews: Live views of C++ containers and lazy generators
+//
+
+//
+// Copyright (c) 2009 Brandon Jones
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//  claim that you wrote the original software. If you use this software
+//  in a product, an acknowledgment in the product documentation would be
+//  appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//  misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source
+//  distribution.
+//
+
+#pragma once
+#if !defined(_SQRAT_CONTAINER_VIEWS_H_)
+#define _SQRAT_CONTAINER_VIEWS_H_
+
+#include <squirrel.h>
+
+#include "sqratClass.h"
+#include "sqratStdContainers.h"
+#include "sqratTypes.h"
+
+#if defined(SQRAT_HAS_EASTL)
+# include <EASTL/functional.h>
+#else
+# include <functional>
+#endif
+
+namespace Sqrat {
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Exposes a vector to Squirrel by reference
+///
+/// \remarks
+/// Pushing a VectorView does not copy the elements: view[i], view[i] = x, view.len() and foreach read and write the
+/// C++ container directly. The container must outlive every script reference to the view.
+/// Use VectorView<const T> for a read-only view.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <class T, class Container = SQRAT_STD::vector<SQRAT_STD::remove_const_t<T>>>
+class VectorView {
+    static_assert(!SQRAT_STD::is_same<SQRAT_STD::remove_const_t<T>, bool>::value, "vector<bool> cannot be viewed by reference");
+
+public:
+    typedef T element_type;
+    typedef SQRAT_STD::conditional_t<SQRAT_STD::is_const<T>::value, const Container, Container> container_type;
+
+    VectorView() : container(nullptr) {}
+    explicit VectorView(container_type& c) : container(&c) {}
+
+    SQInteger Size() const { return container ? static_cast<SQInteger>(container->size()) : 0; }
+    T& At(SQInteger i) const { return (*container)[size_t(i)]; }
+
+    static const SQChar* ClassName() { return _SC("VectorView"); }
+
+private:
+    container_type* container;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Exposes a contiguous block of elements (C array, part of a buffer) to Squirrel by reference
+///
+/// \remarks
+/// Same behavior as VectorView but the size is fixed when the view is created.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <class T>
+class SpanView {
+public:
+    typedef T element_type;
+
+    SpanView() : data(nullptr), size(0) {}
+    SpanView(T* d, SQInteger n) : data(d), size(n) {}
+
+    SQInteger Size() const { return size; }
+    T& At(SQInteger i) const { return data[i]; }
+
+    static const SQChar* ClassName() { return _SC("SpanView"); }
+
+private:
+    T* data;
+    SQInteger size;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Exposes an associative container (map, unordered_map and alike) to Squirrel by reference
+///
+/// \remarks
+/// view[key] looks the key up in the C++ container, view[key] = x assigns or inserts, foreach iterates the container
+/// in its own order. Use MapView<const Map> for a read-only view. The container must outlive every script reference
+/// to the view.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <class Map>
+class MapView {
+public:
+    typedef Map container_type;
+
+    MapView() : container(nullptr) {}
+    explicit MapView(Map& c) : container(&c) {}
+
+    Map* Container() const { return container; }
+    SQInteger Size() const { return container ? static_cast<SQInteger>(container->size()) : 0; }
+
+    static const SQChar* ClassName() { return _SC("MapView"); }
+
+private:
+    Map* container;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Lazy sequence of values pulled from C++ one at a time (range, query result, line reader, ...)
+///
+/// \remarks
+/// foreach over a pushed Generator calls the next function once per iteration, so nothing is materialized up front
+/// and a break in script skips the rest of the work. A generator can be iterated only once; copies share the position.
+/// The next function stores the next value into its argument and returns false when the sequence is exhausted.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <class T>
+class Generator {
+public:
+    typedef T value_type;
+    typedef SQRAT_STD::function<bool(T&)> NextFunc;
+
+    Generator() {}
+    explicit Generator(NextFunc next) : state(new State(SQRAT_STD::move(next))) {}
+
+    /// Pulls the next value, returns false at the end of the sequence
+    bool Advance() {
+        if (!state || !state->next)
+            return false;
+        if (!state->next(state->current)) {
+            state->next = nullptr; // release captured state early
+            return false;
+        }
+        ++state->position;
+        return true;
+    }
+
+    /// Index of the current value, -1 before the first Advance()
+    SQInteger Position() const { return state ? state->position : -1; }
+    const T& Current() const { return state->current; }
+
+    static const SQChar* ClassName() { return _SC("Generator"); }
+
+private:
+    struct State {
+        explicit State(NextFunc &&n) : next(SQRAT_STD::move(n)), current(), position(-1) {}
+        NextFunc next;
+        T current;
+        SQInteger position;
+    };
+    shared_ptr<State> state;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Creates a Generator that yields copies of the elements in [first, last)
+///
+/// \remarks
+/// The iterators are advanced while the script iterates, so the underlying container must stay alive and unchanged.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <class It>
+inline Generator<typename SQRAT_STD::iterator_traits<It>::value_type> Range(It first, It last) {
+    typedef typename SQRAT_STD::iterator_traits<It>::value_type T;
+    return Generator<T>([first, last](T& out) mutable {
+        if (first == last)
+            return false;
+        out = *first;
+        ++first;
+        return true;
+    });
+}
+
+/// Creates a Generator over all elements of a container
+template <class C>
+inline auto Range(C& container) -> decltype(Range(SQRAT_STD::begin(container), SQRAT_STD::end(container))) {
+    return Range(SQRAT_STD::begin(container), SQRAT_STD::end(container));
+}
+
+
+/// Entry of the metamethod table of a view class
+struct ContainerViewMethod {
+    const SQChar* name;
+    SQFUNCTION func;
+    SQInteger nparams;
+};
+
+
+/// Helpers shared by the container view metamethods
+template <class View>
+struct ViewThunksBase {
+
+    // The type tag of the view class is the free variable of every view metamethod
+    static View* Self(HSQUIRRELVM vm) {
+        SQUserPointer tag = nullptr, up = nullptr;
+        sq_getuserpointer(vm, -1, &tag);
+        if (SQ_FAILED(sq_getinstanceup(vm, 1, &up, tag)) || !up)
+            return nullptr;
+        return reinterpret_cast<InstancePtrAndMap<View>*>(up)->first;
+    }
+
+    static SQInteger NotFound(HSQUIRRELVM vm) {
+        sq_pushnull(vm);
+        return sq_throwobject(vm);
+    }
+
+    static SQInteger BadSelf(HSQUIRRELVM vm) {
+        return sq_throwerror(vm, FormatTypeError(vm, 1, View::ClassName()).c_str());
+    }
+
+    static SQInteger Len(HSQUIRRELVM vm) {
+        View* self = Self(vm);
+        if (!self)
+            return BadSelf(vm);
+        sq_pushinteger(vm, self->Size());
+        return 1;
+    }
+
+    // Elements of mutable containers are pushed as references (bound class instances stay live), const ones as copies
+    template <class E>
+    static void PushElement(HSQUIRRELVM vm, E& elem) {
+        PushElementImpl(vm, elem, SQRAT_STD::integral_constant<bool, SQRAT_STD::is_const<E>::value>());
+    }
+
+    template <class E>
+    static void PushElementImpl(HSQUIRRELVM vm, E& elem, SQRAT_STD::true_type) {
+        PushVar(vm, elem);
+    }
+
+    template <class E>
+    static void PushElementImpl(HSQUIRRELVM vm, E& elem, SQRAT_STD::false_type) {
+        PushVarR(vm, elem);
+    }
+
+    template <class E>
+    static SQInteger AssignElement(HSQUIRRELVM vm, E& elem, SQInteger idx, SQRAT_STD::false_type) {
+        if (!Var<E>::check_type(vm, idx))
+            return sq_throwerror(vm, FormatTypeError(vm, idx, Var<E>::getVarTypeName()).c_str());
+        elem = Var<E>(vm, idx).value;
+        return 0;
+    }
+
+    template <class E>
+    static SQInteger AssignElement(HSQUIRRELVM vm, E&, SQInteger, SQRAT_STD::true_type) {
+        return sq_throwerror(vm, _SC("view is read-only"));
+    }
+};
+
+
+/// Metamethods of sequence views (VectorView, SpanView): integer keys index the C++ memory directly
+template <class View>
+struct SequenceViewThunks : ViewThunksBase<View> {
+    typedef ViewThunksBase<View> Base;
+    typedef typename View::element_type E;
+
+    static bool Index(HSQUIRRELVM vm, const View& self, SQInteger& i) {
+        if (sq_gettype(vm, 2) != OT_INTEGER)
+            return false;
+        sq_getinteger(vm, 2, &i);
+        return i >= 0 && i < self.Size();
+    }
+
+    static SQInteger Get(HSQUIRRELVM vm) {
+        View* self = Base::Self(vm);
+        SQInteger i;
+        if (!self || !Index(vm, *self, i))
+            return Base::NotFound(vm);
+        Base::PushElement(vm, self->At(i));
+        return 1;
+    }
+
+    static SQInteger Set(HSQUIRRELVM vm) {
+        View* self = Base::Self(vm);
+        if (!self)
+            return Base::BadSelf(vm);
+        SQInteger i;
+        if (!Index(vm, *self, i))
+            return sq_throwerror(vm, _SC("index out of range"));
+        return Base::AssignElement(vm, self->At(i), 3, SQRAT_STD::integral_constant<bool, SQRAT_STD::is_const<E>::value>());
+    }
+
+    static SQInteger NextI(HSQUIRRELVM vm) {
+        View* self = Base::Self(vm);
+        if (!self)
+            return Base::BadSelf(vm);
+        SQInteger next = 0;
+        if (sq_gettype(vm, 2) == OT_INTEGER) {
+            sq_getinteger(vm, 2, &next);
+            ++next;
+        }
+        if (next < self->Size())
+            sq_pushinteger(vm, next);
+        else
+            sq_pushnull(vm);
+        return 1;
+    }
+
+    static const ContainerViewMethod* Methods() {
+        static const ContainerViewMethod methods[] = {
+            {_SC("_get"),   &SequenceViewThunks::Get,   2},
+            {_SC("_set"),   &SequenceViewThunks::Set,   3},
+            {_SC("_nexti"), &SequenceViewThunks::NextI, 2},
+            {_SC("len"),    &Base::Len,                 1},
+            {nullptr, nullptr, 0}
+        };
+        return methods;
+    }
+};
+
+
+/// Metamethods of MapView
+template <class View>
+struct MapViewThunks : ViewThunksBase<View> {
+    typedef ViewThunksBase<View> Base;
+    typedef typename View::container_type Map;
+    typedef typename Map::key_type K;
+    typedef SQRAT_STD::conditional_t<SQRAT_STD::is_const<Map>::value,
+                                     const typename Map::mapped_type, typename Map::mapped_type> E;
+
+    static SQInteger Get(HSQUIRRELVM vm) {
+        View* self = Base::Self(vm);
+        if (!self || !Var<K>::check_type(vm, 2))
+            return Base::NotFound(vm);
+        auto it = self->Container()->find(Var<K>(vm, 2).value);
+        if (it == self->Container()->end())
+            return Base::NotFound(vm);
+        Base::PushElement(vm, static_cast<E&>(it->second));
+        return 1;
+    }
+
+    static SQInteger Set(HSQUIRRELVM vm) {
+        View* self = Base::Self(vm);
+        if (!self)
+            return Base::BadSelf(vm);
+        if (!Var<K>::check_type(vm, 2))
+            return sq_throwerror(vm, FormatTypeError(vm, 2, Var<K>::getVarTypeName()).c_str());
+        return Insert(vm, *self->Container(), SQRAT_STD::integral_constant<bool, SQRAT_STD::is_const<Map>::value>());
+    }
+
+    static SQInteger NextI(HSQUIRRELVM vm) {
+        View* self = Base::Self(vm);
+        if (!self)
+            return Base::BadSelf(vm);
+        Map& m = *self->Container();
+        auto it = m.begin();
+        if (sq_gettype(vm, 2) != OT_NULL) {
+            it = m.find(Var<K>(vm, 2).value);
+            if (it != m.end())
+                ++it;
+        }
+        if (it != m.end())
+            PushVar(vm, it->first);
+        else
+            sq_pushnull(vm);
+        return 1;
+    }
+
+    static const ContainerViewMethod* Methods() {
+        static const ContainerViewMethod methods[] = {
+            {_SC("_get"),   &MapViewThunks::Get,   2},
+            {_SC("_set"),   &MapViewThunks::Set,   3},
+            {_SC("_nexti"), &MapViewThunks::NextI, 2},
+            {_SC("len"),    &Base::Len,            1},
+            {nullptr, nullptr, 0}
+        };
+        return methods;
+    }
+
+private:
+    static SQInteger Insert(HSQUIRRELVM vm, Map& m, SQRAT_STD::false_type) {
+        typedef typename Map::mapped_type V;
+        if (!Var<V>::check_type(vm, 3))
+            return sq_throwerror(vm, FormatTypeError(vm, 3, Var<V>::getVarTypeName()).c_str());
+        m[Var<K>(vm, 2).value] = Var<V>(vm, 3).value;
+        return 0;
+    }
+
+    static SQInteger Insert(HSQUIRRELVM vm, Map&, SQRAT_STD::true_type) {
+        return sq_throwerror(vm, _SC("view is read-only"));
+    }
+};
+
+
+/// Metamethods of Generator: _nexti pulls the next value, _get returns it for the current key
+template <class View>
+struct GeneratorThunks : ViewThunksBase<View> {
+    typedef ViewThunksBase<View> Base;
+
+    static SQInteger Get(HSQUIRRELVM vm) {
+        View* self = Base::Self(vm);
+        if (!self || sq_gettype(vm, 2) != OT_INTEGER)
+            return Base::NotFound(vm);
+        SQInteger i;
+        sq_getinteger(vm, 2, &i);
+        if (i < 0 || i != self->Position())
+            return Base::NotFound(vm);
+        PushVar(vm, self->Current());
+        return 1;
+    }
+
+    static SQInteger NextI(HSQUIRRELVM vm) {
+        View* self = Base::Self(vm);
+        if (!self)
+            return Base::BadSelf(vm);
+        if (self->Advance())
+            sq_pushinteger(vm, self->Position());
+        else
+            sq_pushnull(vm);
+        return 1;
+    }
+
+    static const ContainerViewMethod* Methods() {
+        static const ContainerViewMethod methods[] = {
+            {_SC("_get"),   &GeneratorThunks::Get,   2},
+            {_SC("_nexti"), &GeneratorThunks::NextI, 2},
+            {nullptr, nullptr, 0}
+        };
+        return methods;
+    }
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Binds the class of a container view to the VM (done automatically the first time a view is pushed)
+///
+/// \remarks
+/// The view class is a regular Sqrat Class; the metamethods listed by Thunks::Methods() (_get, _nexti, ...) replace
+/// the default ones and get the type tag as a free variable, so an access costs one sq_getinstanceup and no registry
+/// lookups.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <class View, class Thunks>
+inline void BindContainerView(HSQUIRRELVM vm) {
+    if (ClassType<View>::hasClassData(vm))
+        return;
+
+    Class<View, CopyOnly<View> > cls(vm, string(View::ClassName()));
+    SQUserPointer typeTag = ClassType<View>::getStaticClassData().lock().get();
+
+    sq_pushobject(vm, cls.GetObject());
+    for (const ContainerViewMethod* m = Thunks::Methods(); m->name; ++m) {
+        sq_pushstring(vm, m->name, -1);
+        sq_pushuserpointer(vm, typeTag); // type tag is passed as a free variable
+        sq_newclosure(vm, m->func, 1);
+        SQRAT_VERIFY(SQ_SUCCEEDED(sq_setparamscheck(vm, m->nparams, nullptr)));
+        SQRAT_VERIFY(SQ_SUCCEEDED(sq_newslot(vm, -3, false)));
+    }
+    sq_pop(vm, 1); // pop class
+}
+
+
+/// Common part of Var specializations for container views
+template <class View, class Thunks>
+struct ContainerViewVar {
+
+    View value; ///< The actual value of get operations
+
+    /// Attempts to get the value off the stack at idx as a view
+    ContainerViewVar(HSQUIRRELVM vm, SQInteger idx) {
+        View* ptr = ClassType<View>::GetInstance(vm, idx);
+        if (ptr != NULL)
+            value = *ptr;
+    }
+
+    /// Called by Sqrat::PushVar to put a view on the stack (binds the view class on first use)
+    static void push(HSQUIRRELVM vm, const View& value) {
+        BindContainerView<View, Thunks>(vm);
+        ClassType<View>::PushInstanceCopy(vm, value);
+    }
+
+    static const SQChar * getVarTypeName() { return View::ClassName(); }
+    static bool check_type(HSQUIRRELVM vm, SQInteger idx) {
+        return ClassType<View>::hasClassData(vm) && ClassType<View>::IsClassInstance(vm, idx);
+    }
+};
+
+template<class T, class C>
+struct Var<VectorView<T, C>> : ContainerViewVar<VectorView<T, C>, SequenceViewThunks<VectorView<T, C>>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : ContainerViewVar<VectorView<T, C>, SequenceViewThunks<VectorView<T, C>>>(vm, idx) {}
+};
+
+template<class T>
+struct Var<SpanView<T>> : ContainerViewVar<SpanView<T>, SequenceViewThunks<SpanView<T>>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : ContainerViewVar<SpanView<T>, SequenceViewThunks<SpanView<T>>>(vm, idx) {}
+};
+
+template<class M>
+struct Var<MapView<M>> : ContainerViewVar<MapView<M>, MapViewThunks<MapView<M>>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : ContainerViewVar<MapView<M>, MapViewThunks<MapView<M>>>(vm, idx) {}
+};
+
+template<class T>
+struct Var<Generator<T>> : ContainerViewVar<Generator<T>, GeneratorThunks<Generator<T>>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : ContainerViewVar<Generator<T>, GeneratorThunks<Generator<T>>>(vm, idx) {}
+};
+
+template<class T, class C> struct Var<const VectorView<T, C>&> : Var<VectorView<T, C>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<VectorView<T, C>>(vm, idx) {}
+};
+
+template<class T> struct Var<const SpanView<T>&> : Var<SpanView<T>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<SpanView<T>>(vm, idx) {}
+};
+
+template<class M> struct Var<const MapView<M>&> : Var<MapView<M>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<MapView<M>>(vm, idx) {}
+};
+
+template<class T> struct Var<const Generator<T>&> : Var<Generator<T>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<Generator<T>>(vm, idx) {}
+};
+
+}
+
+#endif
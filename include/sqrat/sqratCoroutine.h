@@ -0,0 +1,325 @@
+// Sqrat: altered version by Gaijin Entertainment Corp.
+// sqratCoroutine: C++20 coroutines for Quirrel threads and native functions
+//
+
+//
+// Copyright (c) 2009 Brandon Jones
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//  claim that you wrote the original software. If you use this software
+//  in a product, an acknowledgment in the product documentation would be
+//  appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//  misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source
+//  distribution.
+//
+
+
+#pragma once
+#if !defined(_SQRAT_COROUTINE_H_)
+#define _SQRAT_COROUTINE_H_
+
+#if __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
+
+#include <squirrel.h>
+
+#include "sqratGlobalMethods.h"
+#include "sqratTable.h"
+#include "sqratThread.h"
+#include "sqratTypes.h"
+#include "sqratUtil.h"
+
+#include <coroutine>
+#include <exception>
+
+#define SQRAT_HAS_COROUTINES 1
+
+namespace Sqrat {
+
+template <class R = void>
+class Task;
+
+// Part of the Task promise that does not depend on the result type
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation;  ///< Coroutine awaiting this task
+    ScriptThread waiter;                   ///< Script thread suspended in the async native function that started the task
+    std::exception_ptr exception;
+    bool detached = false;
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+
+        template <class Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+            Promise& p = h.promise();
+            if (p.continuation)
+                return p.continuation;
+            if (!p.waiter.IsNull()) {
+                ScriptThread thread = SQRAT_STD::move(p.waiter);
+                p.PushResult(thread.GetThreadVM());
+                if (p.detached)
+                    h.destroy();
+                thread.ResumeWithTop();
+            }
+            else if (p.detached)
+                h.destroy();
+            return std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { exception = std::current_exception(); }
+
+    // Script side of a failure: report it and let the thread continue with null
+    bool ReportException(HSQUIRRELVM vm) const {
+        if (!exception)
+            return false;
+        if (SQPRINTFUNCTION errpf = sq_geterrorfunc(vm))
+            errpf(vm, _SC("Async native function failed with an exception\n"));
+        sq_pushnull(vm);
+        return true;
+    }
+};
+
+template <class R>
+struct TaskPromise : TaskPromiseBase {
+    R result = R();
+
+    Task<R> get_return_object();
+    void return_value(R value) { result = SQRAT_STD::move(value); }
+
+    void PushResult(HSQUIRRELVM vm) {
+        if (!ReportException(vm))
+            PushVar(vm, result);
+    }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object();
+    void return_void() {}
+
+    void PushResult(HSQUIRRELVM vm) {
+        if (!ReportException(vm))
+            sq_pushnull(vm);
+    }
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Lazily started C++ coroutine producing a value of type R
+///
+/// \remarks
+/// A Task can be awaited by another coroutine, started and polled from plain code, or returned from a native function
+/// bound with AsyncFunc(); in the latter case the calling script thread is suspended until the task completes.
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <class R>
+class Task {
+public:
+    typedef TaskPromise<R> promise_type;
+    typedef std::coroutine_handle<promise_type> handle_type;
+
+    Task() {}
+    explicit Task(handle_type h) : handle(h) {}
+    Task(Task&& t) noexcept : handle(t.handle), started(t.started) {
+        t.handle = nullptr;
+        t.started = false;
+    }
+    Task& operator=(Task&& t) noexcept {
+        if (&t != this) {
+            Reset();
+            handle = t.handle;
+            started = t.started;
+            t.handle = nullptr;
+            t.started = false;
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() { Reset(); }
+
+    bool IsValid() const { return bool(handle); }
+    bool IsDone() const { return !handle || handle.done(); }
+
+    /// Runs the task until its first suspension point (does nothing if it has already been started)
+    void Start() {
+        if (handle && !started) {
+            started = true;
+            handle.resume();
+        }
+    }
+
+    /// Result of a finished task, rethrows the exception the task finished with
+    decltype(auto) Result() {
+        SQRAT_ASSERT(IsDone());
+        if (handle.promise().exception)
+            std::rethrow_exception(handle.promise().exception);
+        if constexpr (!SQRAT_STD::is_void<R>::value)
+            return (handle.promise().result);
+    }
+
+    /// Gives the coroutine frame away: it will destroy itself when the task completes
+    handle_type Detach() {
+        handle_type h = handle;
+        if (h)
+            h.promise().detached = true;
+        handle = nullptr;
+        return h;
+    }
+
+    bool await_ready() const noexcept { return IsDone(); }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        if (started)
+            return std::noop_coroutine();
+        started = true;
+        return handle;
+    }
+
+    decltype(auto) await_resume() { return Result(); }
+
+private:
+    void Reset() {
+        if (handle)
+            handle.destroy();
+        handle = nullptr;
+        started = false;
+    }
+
+    handle_type handle;
+    bool started = false;
+};
+
+template <class R>
+inline Task<R> TaskPromise<R>::get_return_object() {
+    return Task<R>(std::coroutine_handle<TaskPromise<R>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+
+/// Awaitable that resumes (or starts) a script thread and returns the value it suspended or returned with
+class ThreadResumeAwaiter {
+public:
+    explicit ThreadResumeAwaiter(ScriptThread& t) : thread(t) {}
+
+    bool await_ready() const noexcept { return true; } // the script runs synchronously until it suspends
+    void await_suspend(std::coroutine_handle<>) const noexcept {}
+
+    Object await_resume() {
+        bool ok = thread.GetState() == ScriptThread::NotStarted ? thread.Start() : thread.Resume();
+        return ok ? thread.GetValue() : Object();
+    }
+
+private:
+    ScriptThread& thread;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Resumes a script thread from a coroutine: Object v = co_await Sqrat::Resume(thread);
+///
+/// \remarks
+/// Check thread.GetState() afterwards to see whether it suspended again, finished or failed.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline ThreadResumeAwaiter Resume(ScriptThread& thread) {
+    return ThreadResumeAwaiter(thread);
+}
+
+
+/// Thunk of native functions returning Task: starts the task and suspends the calling script thread until it's done
+template <class Callable, class R, class... Args>
+struct AsyncThunk {
+    static_assert(SQRAT_STD::conjunction<SQRAT_STD::negation<SQRAT_STD::is_reference<Args>>...>::value,
+                  "async functions must take their arguments by value, the stack is gone when they resume");
+
+    static SQInteger Func(HSQUIRRELVM vm) {
+        if (!vargs::check_var_types<Args...>(vm, 2))
+            return SQ_ERROR;
+
+        // checked before starting, a task that suspends would have nothing to resume
+        ScriptThread thread = ScriptThread::FromVM(vm);
+        if (thread.IsNull())
+            return sq_throwerror(vm, _SC("async function can only be called from a Sqrat::ScriptThread"));
+
+        Callable *method;
+        sq_getuserdata(vm, -1, (SQUserPointer *)&method, NULL);
+        auto vars = vargs::make_vars<Args...>(vm, 2);
+        Task<R> task = vargs::apply(*method, vars);
+
+        task.Start();
+        if (task.IsDone()) {
+            // completed without suspending, no need to suspend the script
+            typename Task<R>::handle_type h = task.Detach();
+            h.promise().PushResult(vm);
+            h.destroy();
+            return 1;
+        }
+
+        thread.WaitExternally(); // only the task may resume it, see Scheduler
+        task.Detach().promise().waiter = SQRAT_STD::move(thread);
+        return sq_suspendvm(vm);
+    }
+};
+
+template <class Callable, class Sig = get_callable_function_t<Callable>>
+struct AsyncThunkFor;
+
+template <class Callable, class R, class... Args>
+struct AsyncThunkFor<Callable, Task<R>(Args...)> {
+    typedef AsyncThunk<Callable, R, Args...> type;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Binds a native coroutine (a callable returning Task<R>) to a table
+///
+/// \param table  Table to bind to
+/// \param name   Name of the function in the table
+/// \param method Callable returning Task<R>, taking its arguments by value
+///
+/// \remarks
+/// The function must be called from a script thread created with ScriptThread; it suspends the thread while the task
+/// awaits C++ async work and resumes it with the task result. A task that completes right away returns its result
+/// directly. Called from anywhere else it throws a script error without starting the task.
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <class F>
+inline TableBase& AsyncFunc(TableBase& table, const SQChar* name, F method) {
+    HSQUIRRELVM vm = table.GetVM();
+    sq_pushobject(vm, table.GetObject());
+    sq_pushstring(vm, name, -1);
+    SQUserPointer methodPtr = sq_newuserdata(vm, sizeof(F));
+    new (methodPtr) F(method);
+    sq_setreleasehook(vm, -1, ImplaceFreeReleaseHook<F>);
+    sq_newclosure(vm, &AsyncThunkFor<F>::type::Func, 1);
+    SQRAT_VERIFY(SQ_SUCCEEDED(sq_setparamscheck(vm, 1 + SqGetArgCount<F>(), nullptr)));
+    SQRAT_VERIFY(SQ_SUCCEEDED(sq_newslot(vm, -3, false)));
+    sq_pop(vm, 1); // pop table
+    return table;
+}
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,234 @@
+// Sqrat: altered version by Gaijin Entertainment Corp.
+// sqratDelegate: Multicast dispatch to Quirrel functions
+//
+
+//
+// Copyright (c) 2009 Brandon Jones
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//  claim that you wrote the original software. If you use this software
+//  in a product, an acknowledgment in the product documentation would be
+//  appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//  misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source
+//  distribution.
+//
+
+
+#pragma once
+#if !defined(_SQRAT_DELEGATE_H_)
+#define _SQRAT_DELEGATE_H_
+
+#include <squirrel.h>
+
+#include "sqratFunction.h"
+#include "sqratTypes.h"
+#include "sqratUtil.h"
+
+#if defined(SQRAT_HAS_EASTL)
+# include <EASTL/vector.h>
+# include <EASTL/chrono.h>
+#else
+# include <vector>
+# include <chrono>
+#endif
+
+namespace Sqrat {
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// List of Quirrel functions called together with the same arguments
+///
+/// \tparam Args Types of the arguments passed to every handler
+///
+/// \remarks
+/// Dispatch() converts the arguments with PushVar once and passes the resulting objects to every handler.
+/// Handlers may subscribe and unsubscribe (themselves or others) while a dispatch is running: removed handlers are
+/// skipped right away, new ones are called starting from the next dispatch.
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <class... Args>
+class Delegate {
+public:
+    typedef SQInteger HandlerId;
+    typedef SQRAT_STD::chrono::steady_clock Clock;
+
+    /// Per-handler statistics collected when timing is enabled
+    struct HandlerStats {
+        SQInteger calls = 0;
+        SQInteger failures = 0;
+        Clock::duration totalTime = Clock::duration::zero();
+        Clock::duration maxTime = Clock::duration::zero();
+    };
+
+    explicit Delegate(HSQUIRRELVM v) : vm(v), nextId(1), dispatchDepth(0), hasRemoved(false), timing(false) {}
+
+    /// Adds a handler and returns its id
+    HandlerId Subscribe(const Function& func) {
+        SQRAT_ASSERT(func.GetVM() == vm);
+        handlers.push_back(Handler{func, nextId, false, HandlerStats()});
+        return nextId++;
+    }
+
+    /// Removes a handler, returns false if there is no handler with such id
+    bool Unsubscribe(HandlerId id) {
+        for (size_t i = 0; i < handlers.size(); ++i) {
+            if (handlers[i].id == id && !handlers[i].removed) {
+                MarkRemoved(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Clear() {
+        for (size_t i = 0; i < handlers.size(); ++i)
+            MarkRemoved(i);
+    }
+
+    SQInteger Size() const {
+        SQInteger n = 0;
+        for (const Handler& h : handlers)
+            n += h.removed ? 0 : 1;
+        return n;
+    }
+
+    bool IsDispatching() const { return dispatchDepth > 0; }
+
+    /// Enables collection of HandlerStats (off by default, reading the clock costs two calls per handler)
+    void EnableTiming(bool enable) { timing = enable; }
+
+    /// Returns statistics of a handler or nullptr if there is no such handler
+    const HandlerStats* GetStats(HandlerId id) const {
+        for (const Handler& h : handlers)
+            if (h.id == id && !h.removed)
+                return &h.stats;
+        return nullptr;
+    }
+
+    void ResetStats() {
+        for (Handler& h : handlers)
+            h.stats = HandlerStats();
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Calls every handler with the given arguments
+    ///
+    /// \return Number of handlers that failed
+    ///
+    /// \remarks
+    /// A failing handler does not stop the dispatch.
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    SQInteger Dispatch(Args const&... args) {
+        static constexpr SQInteger nArgs = sizeof...(Args);
+        HSQUIRRELVM v = vm;
+        SQInteger top = sq_gettop(v);
+
+        // convert the arguments once, the stack keeps them alive during the dispatch
+        HSQOBJECT argObjs[nArgs + 1];
+        int dummy[] = {0, (PushVar(v, args), 0)...};
+        (void)dummy;
+        for (SQInteger i = 0; i < nArgs; ++i)
+            sq_getstackobj(v, top + 1 + i, &argObjs[i]);
+
+        sq_reservestack(v, nArgs + 3);
+
+        SQInteger failed = 0;
+        ++dispatchDepth;
+        // handlers subscribed during the dispatch are not called
+        const size_t count = handlers.size();
+        for (size_t i = 0; i < count; ++i) {
+            if (handlers[i].removed)
+                continue;
+
+            // copy handles: the handler list may be reallocated by a subscription inside the call
+            HSQOBJECT func = handlers[i].func.GetFunc();
+            HSQOBJECT env = handlers[i].func.GetEnv();
+            sq_pushobject(v, func);
+            sq_pushobject(v, env);
+            for (SQInteger a = 0; a < nArgs; ++a)
+                sq_pushobject(v, argObjs[a]);
+
+            Clock::time_point start;
+            if (timing)
+                start = Clock::now();
+
+            bool ok = SQ_SUCCEEDED(sq_call(v, nArgs + 1, SQFalse, SQTrue));
+            sq_pop(v, 1); // sq_call() leaves the closure on the stack
+
+            if (!ok)
+                ++failed;
+            if (timing) {
+                Clock::duration elapsed = Clock::now() - start;
+                HandlerStats& stats = handlers[i].stats;
+                ++stats.calls;
+                stats.failures += ok ? 0 : 1;
+                stats.totalTime += elapsed;
+                if (elapsed > stats.maxTime)
+                    stats.maxTime = elapsed;
+            }
+        }
+        --dispatchDepth;
+
+        if (dispatchDepth == 0 && hasRemoved)
+            Compact();
+
+        sq_settop(v, top);
+        return failed;
+    }
+
+    SQInteger operator()(Args const&... args) {
+        return Dispatch(args...);
+    }
+
+private:
+    struct Handler {
+        Function func;
+        HandlerId id;
+        bool removed;
+        HandlerStats stats;
+    };
+
+    // Handlers are only erased outside of dispatch so that indices stay stable during it
+    void MarkRemoved(size_t i) {
+        handlers[i].removed = true;
+        hasRemoved = true;
+        if (dispatchDepth == 0)
+            Compact();
+    }
+
+    void Compact() {
+        size_t dst = 0;
+        for (size_t i = 0; i < handlers.size(); ++i) {
+            if (handlers[i].removed)
+                continue;
+            if (dst != i)
+                handlers[dst] = SQRAT_STD::move(handlers[i]);
+            ++dst;
+        }
+        handlers.erase(handlers.begin() + dst, handlers.end());
+        hasRemoved = false;
+    }
+
+    HSQUIRRELVM vm;
+    SQRAT_STD::vector<Handler> handlers;
+    HandlerId nextId;
+    SQInteger dispatchDepth;
+    bool hasRemoved;
+    bool timing;
+};
+
+}
+
+#endif
@@ -36,6 +36,16 @@
 
 namespace Sqrat {
 
+// Element type of the argument arrays of Function::ExecuteBatch() and EvaluateBatch()
+template <class T>
+struct IsArgumentTuple : SQRAT_STD::false_type {};
+
+template <class... Args>
+struct IsArgumentTuple<SQRAT_STD::tuple<Args...>> : SQRAT_STD::true_type {};
+
+template <class T>
+struct IsArgumentTuple<const T> : IsArgumentTuple<T> {};
+
 
 class Function  {
 
@@ -43,6 +53,7 @@ class Function  {
     friend class Table;
     friend class ArrayBase;
     friend struct Var<Function>;
+    template <class... Args> friend class PreparedCallBase;
 
 private:
 
@@ -267,7 +278,109 @@ public:
         return Execute(args...);
     }
 
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Calls the function once for every tuple of arguments
+    ///
+    /// \param args      Array of argument tuples
+    /// \param count     Number of calls
+    /// \param succeeded Optional array of count flags receiving the result of every call
+    ///
+    /// \return Number of failed calls
+    ///
+    /// \remarks
+    /// The closure stays on the stack for the whole batch and stack space is reserved once. Failed calls do not stop
+    /// the batch; they are reported through succeeded and a single error message after the batch.
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    template <typename... Args>
+    SQInteger ExecuteBatch(const SQRAT_STD::tuple<Args...>* args, SQInteger count, bool* succeeded = nullptr) const {
+        return CallBatch(args, static_cast<void*>(nullptr), count, succeeded);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Calls the function once for every tuple of arguments and collects the results
+    ///
+    /// \param args      Array of argument tuples
+    /// \param results   Array of count values receiving the results (left unchanged for failed calls)
+    /// \param count     Number of calls
+    /// \param succeeded Optional array of count flags receiving the result of every call
+    ///
+    /// \return Number of failed calls
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    template <class R, typename... Args>
+    SQInteger EvaluateBatch(const SQRAT_STD::tuple<Args...>* args, R* results, SQInteger count, bool* succeeded = nullptr) const {
+        SQRAT_ASSERT(results);
+        return CallBatch(args, results, count, succeeded);
+    }
+
+#if defined(SQRAT_HAS_SPAN)
+    // Spans are taken as span<T> so spans of const and mutable tuples both deduce, the pointer overloads unpack T
+    template <typename T, typename = SQRAT_STD::enable_if_t<IsArgumentTuple<T>::value>>
+    SQInteger ExecuteBatch(span<T> args, span<bool> succeeded = {}) const {
+        SQRAT_ASSERT(succeeded.empty() || succeeded.size() == args.size());
+        return ExecuteBatch(args.data(), static_cast<SQInteger>(args.size()), succeeded.empty() ? nullptr : succeeded.data());
+    }
+
+    template <class R, typename T, typename = SQRAT_STD::enable_if_t<IsArgumentTuple<T>::value>>
+    SQInteger EvaluateBatch(span<T> args, span<R> results, span<bool> succeeded = {}) const {
+        SQRAT_ASSERT(results.size() == args.size());
+        SQRAT_ASSERT(succeeded.empty() || succeeded.size() == args.size());
+        return EvaluateBatch(args.data(), results.data(), static_cast<SQInteger>(args.size()),
+                             succeeded.empty() ? nullptr : succeeded.data());
+    }
+#endif
+
 private:
+    // results == nullptr means the return values are not needed
+    template <class R, typename... Args>
+    SQInteger CallBatch(const SQRAT_STD::tuple<Args...>* args, R* results, SQInteger count, bool* succeeded) const {
+        static constexpr SQInteger nArgs = sizeof...(Args);
+        const SQBool retval = results ? SQTrue : SQFalse;
+        HSQUIRRELVM savedVm = vm; // vm can be nulled in sq_call()
+        SQInteger top = sq_gettop(savedVm);
+        SQInteger failed = 0;
+
+        sq_reservestack(savedVm, nArgs + 3);
+        sq_pushobject(savedVm, obj);
+        HSQOBJECT savedEnv = env;
+
+        for (SQInteger i = 0; i < count; ++i) {
+            sq_pushobject(savedVm, savedEnv);
+            PushTuple(savedVm, args[i], SQRAT_STD::index_sequence_for<Args...>());
+
+            // on both success and failure sq_call() leaves the closure on the stack
+            bool ok = SQ_SUCCEEDED(sq_call(savedVm, nArgs + 1, retval, SQTrue));
+            if (ok && results) {
+                StoreBatchResult(savedVm, results, i);
+                sq_poptop(savedVm);
+            }
+            if (!ok)
+                ++failed;
+            if (succeeded)
+                succeeded[i] = ok;
+        }
+
+        sq_settop(savedVm, top);
+        if (failed)
+            ReportCallError();
+        return failed;
+    }
+
+    template <class R>
+    static void StoreBatchResult(HSQUIRRELVM v, R* results, SQInteger i) {
+        results[i] = Var<R>(v, -1).value;
+    }
+
+    static void StoreBatchResult(HSQUIRRELVM, void*, SQInteger) {
+    }
+
+    template <typename... Args, size_t... I>
+    static void PushTuple(HSQUIRRELVM v, const SQRAT_STD::tuple<Args...>& args, SQRAT_STD::index_sequence<I...>) {
+        int dummy[] = {0, (PushVar(v, SQRAT_STD::get<I>(args)), 0)...};
+        (void)dummy; (void)v;
+    }
+
     template<class Arg, typename... Tail>
     void PushArgs(Arg const& arg, Tail const&... tail) const
     {
@@ -0,0 +1,276 @@
+// Sqrat: altered version by Gaijin Entertainment Corp.
+// sqratLazyClass: Classes bound on first access from scripts
+//
+
+//
+// Copyright (c) 2009 Brandon Jones
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//  claim that you wrote the original software. If you use this software
+//  in a product, an acknowledgment in the product documentation would be
+//  appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//  misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source
+//  distribution.
+//
+
+
+
+#pragma once
+#if !defined(_SQRAT_LAZY_CLASS_H_)
+#define _SQRAT_LAZY_CLASS_H_
+
+#include <squirrel.h>
+
+#include "sqratClass.h"
+#include "sqratObject.h"
+#include "sqratUtil.h"
+
+#if defined(SQRAT_HAS_EASTL)
+# include <EASTL/chrono.h>
+# include <EASTL/functional.h>
+# include <EASTL/vector.h>
+#else
+# include <chrono>
+# include <functional>
+# include <vector>
+#endif
+
+namespace Sqrat {
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Registry of classes that are bound to a VM the first time a script looks them up in the root table
+///
+/// \remarks
+/// Only the binder of each class is stored up front. A _get metamethod is installed in the delegate of the root
+/// table (a clone of the existing delegate, if any, whose own _get is still called for other names); on a lookup of
+/// a registered name the class is bound, stored in the root table and returned, so later lookups never get here.
+///
+/// Lookups that bypass metamethods (rawget, the in operator) do not see classes that have not been bound yet.
+/// Classes used from C++ before any script touched them (e.g. pushing an instance) must be bound with Materialize()
+/// first. The registry must outlive the use of the VM or be destroyed before it, restoring the original delegate.
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class LazyClassRegistry {
+public:
+    typedef SQRAT_STD::chrono::steady_clock Clock;
+
+    /// Binds a class and returns the class object
+    typedef SQRAT_STD::function<Object(HSQUIRRELVM)> Binder;
+
+    /// Called after a class is bound, with the time binding it took
+    typedef SQRAT_STD::function<void(const string&, Clock::duration)> MaterializeCallback;
+
+    struct ClassInfo {
+        string name;
+        bool materialized;
+        Clock::duration bindTime; ///< Time spent binding the class on first access
+    };
+
+    explicit LazyClassRegistry(HSQUIRRELVM v) : vm(v) {
+        sq_resetobject(&prevDelegate);
+        sq_resetobject(&prevGet);
+
+        sq_pushroottable(vm);
+        SQRAT_VERIFY(SQ_SUCCEEDED(sq_getdelegate(vm, -1)));
+        if (sq_gettype(vm, -1) == OT_TABLE) {
+            sq_getstackobj(vm, -1, &prevDelegate);
+            sq_addref(vm, &prevDelegate);
+            sq_pushstring(vm, _SC("_get"), -1);
+            if (SQ_SUCCEEDED(sq_rawget(vm, -2))) {
+                sq_getstackobj(vm, -1, &prevGet);
+                sq_addref(vm, &prevGet);
+                sq_pop(vm, 1); // pop _get
+            }
+            SQRAT_VERIFY(SQ_SUCCEEDED(sq_clone(vm, -1)));
+            sq_remove(vm, -2); // remove the original delegate
+        } else {
+            sq_pop(vm, 1); // pop null delegate
+            sq_newtable(vm);
+        }
+
+        sq_pushstring(vm, _SC("_get"), -1);
+        sq_pushuserpointer(vm, this);
+        sq_newclosure(vm, &GetThunk, 1);
+        SQRAT_VERIFY(SQ_SUCCEEDED(sq_newslot(vm, -3, SQFalse)));
+        SQRAT_VERIFY(SQ_SUCCEEDED(sq_setdelegate(vm, -2)));
+        sq_pop(vm, 1); // pop root table
+    }
+
+    LazyClassRegistry(const LazyClassRegistry&) = delete;
+    LazyClassRegistry& operator=(const LazyClassRegistry&) = delete;
+
+    /// Restores the original delegate of the root table
+    ~LazyClassRegistry() {
+        sq_pushroottable(vm);
+        if (sq_isnull(prevDelegate))
+            sq_pushnull(vm);
+        else
+            sq_pushobject(vm, prevDelegate);
+        sq_setdelegate(vm, -2);
+        sq_pop(vm, 1); // pop root table
+        sq_release(vm, &prevDelegate);
+        sq_release(vm, &prevGet);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Registers a class to be bound on first access
+    ///
+    /// \param name     Name of the class in the root table
+    /// \param binder   Function binding the class and returning the class object
+    /// \param baseName Name of a lazily registered base class, bound before this one
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void Add(const SQChar* name, const Binder& binder, const SQChar* baseName = nullptr) {
+        Entry e;
+        e.name = name;
+        e.binder = binder;
+        if (baseName)
+            e.base = baseName;
+        auto it = index.find(e.name);
+        if (it != index.end()) {
+            entries[it->second] = e; // registering a name again replaces its binder
+            return;
+        }
+        index[e.name] = entries.size();
+        entries.push_back(e);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Registers a Class or DerivedClass to be bound on first access
+    ///
+    /// \param name     Name of the class in the root table (also used as the class name)
+    /// \param bind     Function binding the members, called with the newly created class
+    /// \param baseName Name of a lazily registered base class, bound before this one
+    ///
+    /// \tparam C      Class type to expose
+    /// \tparam ClassT Binding class (Class<C, A> or DerivedClass<C, B, A>)
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    template<class C, class ClassT = Class<C> >
+    void AddClass(const SQChar* name, void (*bind)(ClassT&), const SQChar* baseName = nullptr) {
+        string className(name);
+        Add(name, [className, bind](HSQUIRRELVM v) {
+            ClassT cls(v, string(className));
+            if (bind)
+                bind(cls);
+            return Object(cls.GetObject(), v);
+        }, baseName);
+    }
+
+    /// Binds a registered class now (no-op if it is bound already), returns false for unknown names
+    bool Materialize(const string& name) {
+        Entry* e = Find(name);
+        if (!e || e->materializing)
+            return false;
+        if (e->materialized)
+            return true;
+
+        e->materializing = true;
+        if (!e->base.empty())
+            Materialize(e->base);
+
+        Clock::time_point start = Clock::now();
+        Object cls = e->binder(vm);
+        sq_pushroottable(vm);
+        sq_pushstring(vm, e->name.c_str(), static_cast<SQInteger>(e->name.size()));
+        sq_pushobject(vm, cls.GetObject());
+        SQRAT_VERIFY(SQ_SUCCEEDED(sq_newslot(vm, -3, SQFalse)));
+        sq_pop(vm, 1); // pop root table
+        e->bindTime = Clock::now() - start;
+        e->materializing = false;
+        e->materialized = true;
+        e->binder = nullptr;
+
+        if (onMaterialize)
+            onMaterialize(e->name, e->bindTime);
+        return true;
+    }
+
+    /// Binds all registered classes
+    void MaterializeAll() {
+        for (size_t i = 0; i < entries.size(); ++i)
+            Materialize(entries[i].name);
+    }
+
+    bool IsMaterialized(const string& name) const {
+        auto it = index.find(name);
+        return it != index.end() && entries[it->second].materialized;
+    }
+
+    void SetMaterializeCallback(const MaterializeCallback& callback) {
+        onMaterialize = callback;
+    }
+
+    /// Returns the state and first access cost of every registered class
+    SQRAT_STD::vector<ClassInfo> GetClassInfo() const {
+        SQRAT_STD::vector<ClassInfo> info;
+        info.reserve(entries.size());
+        for (const Entry& e : entries)
+            info.push_back(ClassInfo{e.name, e.materialized, e.bindTime});
+        return info;
+    }
+
+private:
+    struct Entry {
+        string name;
+        string base;
+        Binder binder;
+        bool materialized = false;
+        bool materializing = false;
+        Clock::duration bindTime = Clock::duration::zero();
+    };
+
+    Entry* Find(const string& name) {
+        auto it = index.find(name);
+        return it != index.end() ? &entries[it->second] : nullptr;
+    }
+
+    static SQInteger GetThunk(HSQUIRRELVM vm) {
+        LazyClassRegistry* self = nullptr;
+        sq_getuserpointer(vm, -1, (SQUserPointer*)&self);
+
+        const SQChar* key = nullptr;
+        SQInteger keyLen = 0;
+        if (sq_gettype(vm, 2) == OT_STRING && SQ_SUCCEEDED(sq_getstringandsize(vm, 2, &key, &keyLen))
+            && self->Materialize(string(key, keyLen))) {
+            sq_push(vm, 2);
+            if (SQ_SUCCEEDED(sq_rawget(vm, 1)))
+                return 1;
+        }
+
+        if (!sq_isnull(self->prevGet)) {
+            sq_pushobject(vm, self->prevGet);
+            sq_push(vm, 1);
+            sq_push(vm, 2);
+            if (SQ_SUCCEEDED(sq_call(vm, 2, SQTrue, SQFalse)))
+                return 1;
+            return SQ_ERROR;
+        }
+
+        sq_pushnull(vm);
+        return sq_throwobject(vm);
+    }
+
+    HSQUIRRELVM vm;
+    HSQOBJECT prevDelegate;
+    HSQOBJECT prevGet;
+    SQRAT_STD::vector<Entry> entries;
+    SQRAT_STD::unordered_map<string, size_t> index; ///< Position of each name in entries
+    MaterializeCallback onMaterialize;
+};
+
+}
+
+#endif
@@ -0,0 +1,424 @@
+// Sqrat: altered version by Gaijin Entertainment Corp.
+// sqratModuleCache: Process-wide cache of compiled modules
+//
+
+//
+// Copyright (c) 2009 Brandon Jones
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//  claim that you wrote the original software. If you use this software
+//  in a product, an acknowledgment in the product documentation would be
+//  appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//  misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source
+//  distribution.
+//
+
+
+
+#pragma once
+#if !defined(_SQRAT_MODULE_CACHE_H_)
+#define _SQRAT_MODULE_CACHE_H_
+
+#include <squirrel.h>
+#include <stdint.h>
+
+#include "sqratBytecodeCache.h"
+#include "sqratObject.h"
+#include "sqratTable.h"
+#include "sqratUtil.h"
+
+#if defined(SQRAT_HAS_EASTL)
+# include <EASTL/vector.h>
+#else
+# include <vector>
+#endif
+
+#include <mutex>
+
+namespace Sqrat {
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Process-wide cache of compiled modules, shared by any number of VMs
+///
+/// \remarks
+/// A module is a script file that returns its exports. It is compiled once per process (on the first VM requiring
+/// it) and kept as immutable bytecode; every other VM only reads the closure back and runs it. The compiler inlines
+/// constants, so the bytecode is only shared with VMs whose const table matches the one it was compiled with
+/// (BytecodeKey::Constants()); other VMs compile the module themselves. Exports are cached per VM, so a module runs
+/// once per VM.
+///
+/// Requires made while a module runs are recorded as its dependencies. Refresh() rehashes the files: a changed
+/// module is recompiled on its next Require(), and the modules depending on it, directly or not, are run again so
+/// they pick up the new exports.
+///
+/// The cache is thread safe; a VM must of course still be used by one thread at a time. The cache must outlive the
+/// VMs using it.
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class ModuleCache {
+public:
+    struct Stats {
+        SQInteger compiles = 0;      ///< Modules compiled from source
+        SQInteger loads = 0;         ///< Modules read back from cached bytecode
+        SQInteger instanceHits = 0;  ///< Requires served from the exports already in the VM
+        SQInteger invalidations = 0; ///< Modules invalidated by Refresh() or Invalidate()
+    };
+
+    /// \param root Directory module names are relative to (empty to use the names as paths)
+    explicit ModuleCache(const string& root = string()) : rootDir(root) {}
+
+    ModuleCache(const ModuleCache&) = delete;
+    ModuleCache& operator=(const ModuleCache&) = delete;
+
+    Stats GetStats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Gets the exports of a module in a VM, running it there if needed
+    ///
+    /// \param vm      VM to instantiate the module in
+    /// \param name    Module name (path relative to the root directory)
+    /// \param exports Object that receives the value returned by the module
+    /// \param errMsg  String that is filled with the compiler or runtime error
+    ///
+    /// \return False if the module could not be read, compiled or run
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    bool Require(HSQUIRRELVM vm, const string& name, Object& exports, string& errMsg) {
+        SQRAT_STD::shared_ptr<const Bytecode> bytecode;
+        SQInteger version = 0;
+        uint64_t bytecodeConsts = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto l = loading.find(vm);
+            if (l != loading.end()) {
+                for (const string& n : l->second) {
+                    if (n == name) {
+                        errMsg = string(_SC("circular require of module '")) + name + _SC("'");
+                        return false;
+                    }
+                }
+                AddDependency(l->second.back(), name);
+            }
+
+            auto it = modules.find(name);
+            if (it != modules.end() && it->second.bytecode) {
+                bytecode = it->second.bytecode;
+                version = it->second.version;
+                bytecodeConsts = it->second.consts;
+            }
+        }
+
+        if (bytecode && GetInstance(vm, name, version, exports)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++stats.instanceHits;
+            return true;
+        }
+
+        SQInteger top = sq_gettop(vm);
+        const uint64_t consts = BytecodeKey::Constants(vm);
+        if (bytecode && bytecodeConsts != consts)
+            bytecode.reset(); // compiled with other constants, compile in this VM instead
+        if (bytecode) {
+            BytecodeMemoryReader reader{bytecode->data(), bytecode->size()};
+            if (SQ_FAILED(sq_readclosure(vm, &BytecodeMemoryReader::Read, &reader))) {
+                errMsg = LastErrorString(vm);
+                sq_settop(vm, top);
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            ++stats.loads;
+        }
+        else if (!Compile(vm, name, consts, version, errMsg)) {
+            sq_settop(vm, top);
+            return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            loading[vm].push_back(name);
+        }
+        sq_pushroottable(vm);
+        SQRESULT result = sq_call(vm, 1, SQTrue, SQTrue);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            SQRAT_STD::vector<string>& stack = loading[vm];
+            stack.pop_back();
+            if (stack.empty())
+                loading.erase(vm);
+        }
+        if (SQ_FAILED(result)) {
+            errMsg = LastErrorString(vm);
+            sq_settop(vm, top);
+            return false;
+        }
+
+        HSQOBJECT value;
+        sq_getstackobj(vm, -1, &value);
+        exports = Object(value, vm);
+        SetInstance(vm, name, version, value);
+        sq_settop(vm, top);
+        return true;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Binds a require(name) function returning the exports of a module
+    ///
+    /// \param table Table to bind the function to (usually the root table)
+    /// \param name  Name of the function
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void BindRequire(TableBase& table, const SQChar* name = _SC("require")) {
+        HSQUIRRELVM vm = table.GetVM();
+        sq_pushobject(vm, table.GetObject());
+        sq_pushstring(vm, name, -1);
+        sq_pushuserpointer(vm, this);
+        sq_newclosure(vm, &RequireThunk, 1);
+        SQRAT_VERIFY(SQ_SUCCEEDED(sq_setparamscheck(vm, 2, _SC(".s"))));
+        sq_setnativeclosurename(vm, -1, name);
+        SQRAT_VERIFY(SQ_SUCCEEDED(sq_newslot(vm, -3, SQFalse)));
+        sq_pop(vm, 1); // pop table
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Rehashes the files of all compiled modules and invalidates the changed ones along with their dependents
+    ///
+    /// \return Number of modules invalidated
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    SQInteger Refresh() {
+        SQRAT_STD::vector<string> names;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto& m : modules)
+                if (m.second.bytecode)
+                    names.push_back(m.first);
+        }
+
+        SQInteger count = 0;
+        string source;
+        for (const string& name : names) {
+            bool readable = BytecodeCache::ReadFile(PathOf(name), source);
+            uint64_t hash = readable ? Hash(source) : 0;
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = modules.find(name);
+            if (it != modules.end() && it->second.bytecode && (!readable || it->second.hash != hash))
+                count += InvalidateLocked(name);
+        }
+        return count;
+    }
+
+    /// Invalidates a module so it is recompiled, and its dependents so they are run again; returns the number of modules invalidated
+    SQInteger Invalidate(const string& name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return InvalidateLocked(name);
+    }
+
+    /// Drops all compiled modules (exports already in VMs are replaced on their next Require())
+    void Clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& m : modules) {
+            m.second.bytecode.reset();
+            m.second.version = ++versionCounter;
+        }
+    }
+
+    /// Returns the modules required by a module the last time it ran
+    SQRAT_STD::vector<string> GetDependencies(const string& name) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = modules.find(name);
+        return it != modules.end() ? it->second.dependencies : SQRAT_STD::vector<string>();
+    }
+
+private:
+    typedef SQRAT_STD::vector<char> Bytecode;
+
+    struct Module {
+        uint64_t hash = 0;
+        uint64_t consts = 0;                           ///< Const table digest of the VM the bytecode was compiled in
+        SQInteger version = 0;                         ///< Changes whenever the exports in VMs become stale
+        SQRAT_STD::shared_ptr<const Bytecode> bytecode; ///< Null until compiled or after invalidation
+        SQRAT_STD::vector<string> dependencies;
+    };
+
+    static SQInteger RequireThunk(HSQUIRRELVM vm) {
+        ModuleCache* self = nullptr;
+        sq_getuserpointer(vm, -1, (SQUserPointer*)&self);
+        const SQChar* name = nullptr;
+        sq_getstring(vm, 2, &name);
+
+        Object exports;
+        string errMsg;
+        if (!self->Require(vm, name, exports, errMsg))
+            return sq_throwerror(vm, errMsg.c_str());
+        sq_pushobject(vm, exports.GetObject());
+        return 1;
+    }
+
+    static uint64_t Hash(const string& source) {
+        uint64_t h = 14695981039346656037ull;
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(source.data());
+        for (size_t i = 0, n = source.size() * sizeof(SQChar); i < n; ++i)
+            h = (h ^ p[i]) * 1099511628211ull;
+        return h;
+    }
+
+    static SQInteger Write(SQUserPointer up, SQUserPointer buf, SQInteger size) {
+        Bytecode* data = static_cast<Bytecode*>(up);
+        const char* p = static_cast<const char*>(buf);
+        data->insert(data->end(), p, p + size);
+        return size;
+    }
+
+    string PathOf(const string& name) const {
+        if (rootDir.empty())
+            return name;
+        return rootDir + _SC("/") + name;
+    }
+
+    // Compiles the module from its file, leaving the closure on the stack and storing its bytecode if there is none
+    bool Compile(HSQUIRRELVM vm, const string& name, uint64_t consts, SQInteger& version, string& errMsg) {
+        const string path = PathOf(name);
+        string source;
+        if (!BytecodeCache::ReadFile(path, source)) {
+            errMsg = string(_SC("cannot read module '")) + name + _SC("'");
+            return false;
+        }
+        if (SQ_FAILED(sq_compilebuffer(vm, source.data(), static_cast<SQInteger>(source.size()), path.c_str(), SQFalse))) {
+            errMsg = LastErrorString(vm);
+            return false;
+        }
+
+        SQRAT_STD::shared_ptr<Bytecode> bytecode(new Bytecode());
+        bool serialized = SQ_SUCCEEDED(sq_writeclosure(vm, &Write, bytecode.get()));
+
+        std::lock_guard<std::mutex> lock(mutex);
+        ++stats.compiles;
+        Module& m = modules[name];
+        if (!m.bytecode && serialized) {
+            m.hash = Hash(source);
+            m.consts = consts;
+            m.bytecode = bytecode;
+            m.dependencies.clear(); // recorded again while the module runs
+            m.version = ++versionCounter;
+        }
+        version = m.version;
+        return true;
+    }
+
+    void AddDependency(const string& module, const string& dependency) {
+        SQRAT_STD::vector<string>& deps = modules[module].dependencies;
+        for (const string& d : deps)
+            if (d == dependency)
+                return;
+        deps.push_back(dependency);
+    }
+
+    SQInteger InvalidateLocked(const string& name) {
+        auto it = modules.find(name);
+        if (it == modules.end())
+            return 0;
+        it->second.bytecode.reset();
+
+        // Dependents keep their bytecode but get a new version, so VMs run them again
+        SQRAT_STD::vector<string> pending(1, name);
+        SQRAT_STD::unordered_map<string, bool> visited;
+        visited[name] = true;
+        SQInteger count = 0;
+        while (!pending.empty()) {
+            string current = pending.back();
+            pending.pop_back();
+            modules[current].version = ++versionCounter;
+            ++stats.invalidations;
+            ++count;
+            for (auto& m : modules) {
+                if (visited.count(m.first))
+                    continue;
+                for (const string& d : m.second.dependencies) {
+                    if (d == current) {
+                        visited[m.first] = true;
+                        pending.push_back(m.first);
+                        break;
+                    }
+                }
+            }
+        }
+        return count;
+    }
+
+    // Per VM exports live in the registry table: registry[this][name] = [version, exports]
+    bool GetInstance(HSQUIRRELVM vm, const string& name, SQInteger version, Object& exports) {
+        bool found = false;
+        sq_pushregistrytable(vm);
+        sq_pushuserpointer(vm, this);
+        if (SQ_SUCCEEDED(sq_rawget(vm, -2))) {
+            sq_pushstring(vm, name.c_str(), static_cast<SQInteger>(name.size()));
+            if (SQ_SUCCEEDED(sq_rawget(vm, -2))) {
+                SQInteger instanceVersion = -1;
+                sq_pushinteger(vm, 0);
+                if (SQ_SUCCEEDED(sq_rawget(vm, -2))) {
+                    sq_getinteger(vm, -1, &instanceVersion);
+                    sq_pop(vm, 1); // pop version
+                }
+                if (instanceVersion == version) {
+                    sq_pushinteger(vm, 1);
+                    if (SQ_SUCCEEDED(sq_rawget(vm, -2))) {
+                        HSQOBJECT value;
+                        sq_getstackobj(vm, -1, &value);
+                        exports = Object(value, vm);
+                        found = true;
+                        sq_pop(vm, 1); // pop exports
+                    }
+                }
+                sq_pop(vm, 1); // pop instance
+            }
+            sq_pop(vm, 1); // pop module table
+        }
+        sq_pop(vm, 1); // pop registry table
+        return found;
+    }
+
+    void SetInstance(HSQUIRRELVM vm, const string& name, SQInteger version, HSQOBJECT value) {
+        sq_pushregistrytable(vm);
+        sq_pushuserpointer(vm, this);
+        if (SQ_FAILED(sq_rawget(vm, -2))) {
+            sq_newtable(vm);
+            sq_pushuserpointer(vm, this);
+            sq_push(vm, -2);
+            sq_rawset(vm, -4);
+        }
+        sq_pushstring(vm, name.c_str(), static_cast<SQInteger>(name.size()));
+        sq_newarray(vm, 0);
+        sq_pushinteger(vm, version);
+        sq_arrayappend(vm, -2);
+        sq_pushobject(vm, value);
+        sq_arrayappend(vm, -2);
+        sq_rawset(vm, -3);
+        sq_pop(vm, 2); // pop module table and registry table
+    }
+
+    string rootDir;
+    mutable std::mutex mutex;
+    SQRAT_STD::unordered_map<string, Module> modules;
+    SQRAT_STD::unordered_map<HSQUIRRELVM, SQRAT_STD::vector<string>> loading; ///< Modules being run, per VM
+    SQInteger versionCounter = 0;
+    Stats stats;
+};
+
+}
+
+#endif
@@ -0,0 +1,184 @@
+// Sqrat: altered version by Gaijin Entertainment Corp.
+// sqratParallelMap: Script function mapped over data on worker VMs
+//
+
+//
+// Copyright (c) 2009 Brandon Jones
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//  claim that you wrote the original software. If you use this software
+//  in a product, an acknowledgment in the product documentation would be
+//  appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//  misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source
+//  distribution.
+//
+
+
+
+#pragma once
+#if !defined(_SQRAT_PARALLEL_MAP_H_)
+#define _SQRAT_PARALLEL_MAP_H_
+
+#include <squirrel.h>
+
+#include "sqratArray.h"
+#include "sqratPreparedCall.h"
+#include "sqratTable.h"
+#include "sqratUtil.h"
+#include "sqratWorkerPool.h"
+
+#if defined(SQRAT_HAS_EASTL)
+# include <EASTL/vector.h>
+#else
+# include <vector>
+#endif
+
+namespace Sqrat {
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Calls a script function on every element of a C array, spreading chunks of it over the workers of a pool
+///
+/// \param pool         Worker pool whose VMs all define the function in their root table
+/// \param functionName Name of the function, called with one element and returning the result
+/// \param input        Elements to map
+/// \param count        Number of elements
+/// \param output       Array of count results, stored in input order
+/// \param errMsg       String that is filled with the first error
+/// \param chunkSize    Elements per job (0 picks about four chunks per worker)
+///
+/// \tparam R Result type
+/// \tparam T Element type
+///
+/// \return False if a call failed (the results of the other calls are still stored)
+///
+/// \remarks
+/// The function must be pure: chunks run in any order on any VM. Each job calls it through a PreparedCall and
+/// writes straight into its own range of output, so no results are copied afterwards. input and output must stay
+/// valid until the call returns; it blocks until all chunks are done.
+/// Don't call it from a job running on the same pool: the job would wait for chunks queued behind it, and with every
+/// worker waiting like that the pool deadlocks.
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template<class R, class T>
+bool ParallelMap(VMWorkerPool& pool, const SQChar* functionName, const T* input, size_t count, R* output,
+                 string& errMsg, size_t chunkSize = 0)
+{
+    if (count == 0)
+        return true;
+    if (chunkSize == 0)
+        chunkSize = count / (pool.GetWorkerCount() * 4);
+    if (chunkSize == 0)
+        chunkSize = 1;
+
+    const string name(functionName);
+    SQRAT_STD::vector<std::future<string> > chunks;
+    chunks.reserve((count + chunkSize - 1) / chunkSize);
+    for (size_t first = 0; first < count; first += chunkSize) {
+        const size_t last = count - first > chunkSize ? first + chunkSize : count;
+        chunks.push_back(pool.Run([&name, input, output, first, last](HSQUIRRELVM vm) {
+            PreparedCall<R(T)> call(RootTable(vm).GetFunction(name.c_str()));
+            if (!call.IsValid())
+                return string(_SC("function not found or not callable with one argument: ")) + name;
+            for (size_t i = first; i < last; ++i)
+                if (!call.Evaluate(input[i], output[i]))
+                    return LastErrorString(vm);
+            return string();
+        }));
+    }
+
+    bool ok = true;
+    for (std::future<string>& chunk : chunks) {
+        string err = chunk.get();
+        if (ok && !err.empty()) {
+            errMsg = err;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+/// Maps a script function over a vector, see ParallelMap(VMWorkerPool&, const SQChar*, const T*, size_t, R*, string&, size_t)
+template<class R, class T>
+bool ParallelMap(VMWorkerPool& pool, const SQChar* functionName, const SQRAT_STD::vector<T>& input, SQRAT_STD::vector<R>& output,
+                 string& errMsg, size_t chunkSize = 0)
+{
+    static_assert(!SQRAT_STD::is_same<R, bool>::value && !SQRAT_STD::is_same<T, bool>::value, "vector<bool> has no contiguous storage, use the C array overload");
+    output.resize(input.size());
+    return ParallelMap(pool, functionName, input.data(), input.size(), output.data(), errMsg, chunkSize);
+}
+
+// Numbers are read in bulk with the usual array conversions
+template<class T>
+bool ParallelMapReadElements(ArrayBase& input, SQRAT_STD::vector<T>& elements, string& errMsg, SQRAT_STD::true_type) {
+    const SQInteger count = static_cast<SQInteger>(elements.size());
+    if (input.CopyTo(elements.data(), count) == count)
+        return true;
+    errMsg = _SC("failed to read the array elements");
+    return false;
+}
+
+// Other elements are type checked one by one, so a mismatch is an error rather than an assertion
+template<class T>
+bool ParallelMapReadElements(ArrayBase& input, SQRAT_STD::vector<T>& elements, string& errMsg, SQRAT_STD::false_type) {
+    HSQUIRRELVM vm = input.GetVM();
+    sq_pushobject(vm, input.GetObject());
+    bool ok = true;
+    for (size_t i = 0; ok && i < elements.size(); ++i) {
+        sq_pushinteger(vm, static_cast<SQInteger>(i));
+        SQRAT_VERIFY(SQ_SUCCEEDED(sq_rawget(vm, -2)));
+        ok = Var<T>::check_type(vm, -1);
+        if (ok)
+            elements[i] = Var<T>(vm, -1).value;
+        else
+            errMsg = FormatTypeError(vm, -1, Var<T>::getVarTypeName());
+        sq_pop(vm, 1); // pop element
+    }
+    sq_pop(vm, 1); // pop array
+    return ok;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Maps a script function over a Quirrel array, spreading chunks of it over the workers of a pool
+///
+/// \remarks
+/// The elements are read as T into a C++ buffer, mapped on the workers and the results replace the contents of
+/// output, so both arrays may belong to a VM that is not part of the pool. Elements that can't be read as T make it
+/// return false without calling the function or touching output. See
+/// ParallelMap(VMWorkerPool&, const SQChar*, const T*, size_t, R*, string&, size_t).
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template<class R, class T>
+bool ParallelMap(VMWorkerPool& pool, const SQChar* functionName, ArrayBase& input, ArrayBase& output,
+                 string& errMsg, size_t chunkSize = 0)
+{
+    static_assert(!SQRAT_STD::is_same<R, bool>::value && !SQRAT_STD::is_same<T, bool>::value, "vector<bool> has no contiguous storage, use the C array overload");
+    SQRAT_STD::vector<T> elements(static_cast<size_t>(input.Length()));
+    if (!ParallelMapReadElements(input, elements, errMsg, SQRAT_STD::integral_constant<bool, SQRAT_STD::is_arithmetic<T>::value>()))
+        return false;
+
+    SQRAT_STD::vector<R> results;
+    bool ok = ParallelMap(pool, functionName, elements, results, errMsg, chunkSize);
+
+    HSQUIRRELVM vm = output.GetVM();
+    sq_pushobject(vm, output.GetObject());
+    SQRAT_VERIFY(SQ_SUCCEEDED(sq_arrayresize(vm, -1, static_cast<SQInteger>(results.size()))));
+    ArrayBase::StoreRange(vm, -1, 0, results.begin(), static_cast<SQInteger>(results.size()));
+    sq_pop(vm, 1); // pop array
+    return ok;
+}
+
+}
+
+#endif
@@ -0,0 +1,208 @@
+// Sqrat: altered version by Gaijin Entertainment Corp.
+// sqratPreparedCall: Reusable typed calls of Quirrel functions
+//
+
+//
+// Copyright (c) 2009 Brandon Jones
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//  claim that you wrote the original software. If you use this software
+//  in a product, an acknowledgment in the product documentation would be
+//  appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//  misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source
+//  distribution.
+//
+
+
+#pragma once
+#if !defined(_SQRAT_PREPARED_CALL_H_)
+#define _SQRAT_PREPARED_CALL_H_
+
+#include <squirrel.h>
+
+#include "sqratFunction.h"
+#include "sqratTypes.h"
+#include "sqratUtil.h"
+
+namespace Sqrat {
+
+/// Common part of PreparedCall specializations
+template <class... Args>
+class PreparedCallBase {
+public:
+    static constexpr SQInteger nArgs = sizeof...(Args);
+
+    /// Returns true if the function was prepared successfully and can be called
+    bool IsValid() const { return valid; }
+
+    const Function& GetFunction() const { return func; }
+
+    PreparedCallBase(const PreparedCallBase&) = default;
+    PreparedCallBase& operator=(const PreparedCallBase&) = default;
+
+    PreparedCallBase(PreparedCallBase&& pc) : func(SQRAT_STD::move(pc.func)), valid(pc.valid) {
+        pc.valid = false; // moved from Function can't be called
+    }
+
+    PreparedCallBase& operator=(PreparedCallBase&& pc) {
+        if (&pc != this) {
+            func = SQRAT_STD::move(pc.func);
+            valid = pc.valid;
+            pc.valid = false;
+        }
+        return *this;
+    }
+
+protected:
+    PreparedCallBase() : valid(false) {}
+
+    PreparedCallBase(const Function& f, bool checkArity) : func(f), valid(false) {
+        HSQUIRRELVM vm = func.GetVM();
+        if (!vm || func.IsNull())
+            return;
+        valid = !checkArity || CheckArity(vm);
+        // closure, environment, arguments and return value
+        if (valid)
+            valid = SQ_SUCCEEDED(sq_reservestack(vm, nArgs + 3));
+    }
+
+    bool CheckArity(HSQUIRRELVM vm) const {
+        SQInteger nparams = 0, nfreevars = 0;
+        const SQInteger passed = nArgs + 1; // 'this' is a parameter too
+        bool ok = true;
+
+        sq_pushobject(vm, func.GetFunc());
+        SQObjectType type = sq_gettype(vm, -1);
+        if (type == OT_NATIVECLOSURE) {
+            if (SQ_SUCCEEDED(sq_getclosureinfo(vm, -1, &nparams, &nfreevars)) && nparams != 0)
+                ok = nparams > 0 ? passed == nparams : passed >= -nparams;
+        }
+        else if (type == OT_CLOSURE) {
+            // default parameters may be omitted, vararg closures report their named parameters only
+            if (SQ_SUCCEEDED(sq_getclosureinfo(vm, -1, &nparams, &nfreevars)))
+                ok = passed <= nparams;
+        }
+        else
+            ok = type == OT_CLASS;
+        sq_pop(vm, 1); // pop closure
+        return ok;
+    }
+
+    // Pushes closure, environment and arguments, calls and pops everything except the return value
+    bool Call(SQBool retval, Args const&... args) const {
+        if (!valid)
+            return false;
+
+        HSQUIRRELVM vm = func.GetVM(); // this object may be destroyed in sq_call()
+        sq_pushobject(vm, func.GetFunc());
+        sq_pushobject(vm, func.GetEnv());
+        int dummy[] = {0, (PushVar(vm, args), 0)...};
+        (void)dummy;
+
+        if (SQ_FAILED(sq_call(vm, nArgs + 1, retval, SQTrue))) {
+            sq_pop(vm, 1); // sq_call() leaves the closure on the stack
+            func.ReportCallError();
+            return false;
+        }
+        return true;
+    }
+
+    Function func;
+    bool valid;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Reusable call of a Quirrel function with a fixed signature
+///
+/// \tparam Sig Signature of the call, R(Args...)
+///
+/// \remarks
+/// The arity of the closure is checked and stack space is reserved once, when the PreparedCall is constructed, so every
+/// invocation is just a push/call/pop sequence with no name lookups. Errors are reported only when a call fails.
+/// Vararg closures are validated against their named parameters only; pass checkArity = false to call them with more
+/// arguments.
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <class Sig>
+class PreparedCall;
+
+template <class R, class... Args>
+class PreparedCall<R(Args...)> : public PreparedCallBase<Args...> {
+    typedef PreparedCallBase<Args...> Base;
+
+public:
+    PreparedCall() {}
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Prepares calls of a function
+    ///
+    /// \param f          Function to call
+    /// \param checkArity Whether to check that the function accepts sizeof...(Args) arguments
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    explicit PreparedCall(const Function& f, bool checkArity = true) : Base(f, checkArity) {}
+
+    /// Calls the function and stores its result in ret, returns false if the call failed
+    bool Evaluate(Args const&... args, R& ret) const {
+        HSQUIRRELVM vm = this->func.GetVM();
+        if (!Base::Call(SQTrue, args...))
+            return false;
+        ret = Var<R>(vm, -1).value;
+        sq_pop(vm, 2); // pop return value and closure
+        return true;
+    }
+
+    /// Calls the function and returns its result, or a default constructed R if the call failed
+    R operator()(Args const&... args) const {
+        R ret = R();
+        Evaluate(args..., ret);
+        return ret;
+    }
+};
+
+template <class... Args>
+class PreparedCall<void(Args...)> : public PreparedCallBase<Args...> {
+    typedef PreparedCallBase<Args...> Base;
+
+public:
+    PreparedCall() {}
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Prepares calls of a function
+    ///
+    /// \param f          Function to call
+    /// \param checkArity Whether to check that the function accepts sizeof...(Args) arguments
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    explicit PreparedCall(const Function& f, bool checkArity = true) : Base(f, checkArity) {}
+
+    /// Calls the function ignoring its result, returns false if the call failed
+    bool Execute(Args const&... args) const {
+        HSQUIRRELVM vm = this->func.GetVM();
+        if (!Base::Call(SQFalse, args...))
+            return false;
+        sq_pop(vm, 1); // pop closure
+        return true;
+    }
+
+    bool operator()(Args const&... args) const {
+        return Execute(args...);
+    }
+};
+
+}
+
+#endif
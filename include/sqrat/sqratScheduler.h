@@ -0,0 +1,305 @@
+// Sqrat: altered version by Gaijin Entertainment Corp.
+// sqratScheduler: Cooperative scheduling of Quirrel threads
+//
+
+//
+// Copyright (c) 2009 Brandon Jones
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//  claim that you wrote the original software. If you use this software
+//  in a product, an acknowledgment in the product documentation would be
+//  appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//  misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source
+//  distribution.
+//
+
+
+#pragma once
+#if !defined(_SQRAT_SCHEDULER_H_)
+#define _SQRAT_SCHEDULER_H_
+
+#include <squirrel.h>
+
+#include "sqratFunction.h"
+#include "sqratThread.h"
+#include "sqratUtil.h"
+
+#if defined(SQRAT_HAS_EASTL)
+# include <EASTL/vector.h>
+# include <EASTL/heap.h>
+# include <EASTL/chrono.h>
+# include <EASTL/functional.h>
+#else
+# include <vector>
+# include <algorithm>
+# include <chrono>
+# include <functional>
+#endif
+
+namespace Sqrat {
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Runs many script threads cooperatively, resuming them by deadline or signal
+///
+/// \remarks
+/// A task tells the scheduler what to wait for through the value it passes to suspend():
+///  - null (or nothing): run again on the next tick
+///  - number: sleep for that many seconds
+///  - string: wait until Signal() with that name is raised
+/// A task suspended by native code that resumes it itself (ScriptThread::WaitExternally(), e.g. an AsyncFunc()) is
+/// left parked; once resumed it is picked up again on the next tick from wherever it stopped.
+/// Ready tasks are kept in a heap ordered by deadline, so a tick only touches tasks that are due. Tick() stops when its
+/// time budget is spent; tasks that stay due for longer than the starvation threshold are reported by GetStarved().
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class Scheduler {
+public:
+    typedef SQInteger TaskId;
+    typedef SQRAT_STD::chrono::steady_clock Clock;
+
+    struct StarvedTask {
+        TaskId id;
+        Clock::duration overdue; ///< How long the task has been ready without being resumed
+    };
+
+    struct TickStats {
+        SQInteger resumed = 0;  ///< Tasks resumed during the tick
+        SQInteger finished = 0; ///< Tasks that returned
+        SQInteger failed = 0;   ///< Tasks that failed with an error
+        SQInteger pending = 0;  ///< Ready tasks left for the next tick because the budget was spent
+        Clock::duration elapsed = Clock::duration::zero();
+    };
+
+    Scheduler() : nextId(1), running(0), killRunning(false), starvationThreshold(SQRAT_STD::chrono::milliseconds(100)) {}
+
+    /// Creates a task running func(args...), it is started on the next tick
+    template <typename... Args>
+    TaskId Spawn(const Function& func, Args const&... args) {
+        TaskId id = nextId++;
+        TaskEntry& task = tasks[id];
+        task.thread = ScriptThread(func);
+        task.start = [args...](ScriptThread& t) { return t.Start(args...); };
+        MakeReady(id, task, Clock::now());
+        return id;
+    }
+
+    /// Removes a task, the script thread is released (when the task is running, after it suspends)
+    bool Kill(TaskId id) {
+        if (id == running) {
+            killRunning = true;
+            return true;
+        }
+        return tasks.erase(id) != 0;
+    }
+
+    /// Makes a sleeping or waiting task ready (not one parked in native code, which must resume it itself)
+    bool Wake(TaskId id) {
+        auto it = tasks.find(id);
+        if (it == tasks.end() || it->second.thread.IsWaitingExternally())
+            return false;
+        MakeReady(id, it->second, Clock::now());
+        return true;
+    }
+
+    /// Makes all tasks waiting for the signal ready, returns their number
+    SQInteger Signal(const string& name) {
+        auto it = waiters.find(name);
+        if (it == waiters.end())
+            return 0;
+        SQRAT_STD::vector<Waiter> list = SQRAT_STD::move(it->second);
+        waiters.erase(it);
+
+        SQInteger woken = 0;
+        Clock::time_point now = Clock::now();
+        for (const Waiter& w : list) {
+            auto t = tasks.find(w.id);
+            if (t != tasks.end() && t->second.generation == w.generation) {
+                MakeReady(w.id, t->second, now);
+                ++woken;
+            }
+        }
+        return woken;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Resumes due tasks in deadline order
+    ///
+    /// \param budget Time after which no more tasks are resumed (at least one due task is always resumed)
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    const TickStats& Tick(Clock::duration budget = (Clock::duration::max)()) {
+        stats = TickStats();
+        starved.clear();
+        const Clock::time_point tickStart = Clock::now();
+        Clock::time_point now = tickStart;
+
+        // tasks resumed by native code since the last tick tell what they wait for now
+        if (!parked.empty()) {
+            SQRAT_STD::vector<TaskId> list;
+            list.swap(parked);
+            for (TaskId id : list) {
+                auto it = tasks.find(id);
+                if (it == tasks.end())
+                    continue;
+                if (it->second.thread.IsWaitingExternally())
+                    parked.push_back(id);
+                else
+                    Settle(id, it->second);
+            }
+        }
+
+        // tasks made ready during the tick get a later deadline and wait for the next tick
+        while (!ready.empty() && ready.front().deadline <= tickStart) {
+            if (stats.resumed > 0 && now - tickStart >= budget)
+                break;
+
+            HeapItem item = ready.front();
+            SQRAT_STD::pop_heap(ready.begin(), ready.end(), HeapItem::Later);
+            ready.pop_back();
+
+            auto it = tasks.find(item.id);
+            if (it == tasks.end() || it->second.generation != item.generation)
+                continue; // killed or rescheduled
+
+            Run(item.id, it->second);
+            ++stats.resumed;
+            now = Clock::now();
+        }
+
+        stats.elapsed = now - tickStart;
+        CollectPending(0, tickStart, now);
+        return stats;
+    }
+
+    /// Tasks that were due for longer than the starvation threshold at the end of the last tick
+    const SQRAT_STD::vector<StarvedTask>& GetStarved() const { return starved; }
+
+    void SetStarvationThreshold(Clock::duration threshold) { starvationThreshold = threshold; }
+
+    SQInteger Size() const { return static_cast<SQInteger>(tasks.size()); }
+
+    bool Contains(TaskId id) const { return tasks.find(id) != tasks.end(); }
+
+private:
+    struct TaskEntry {
+        ScriptThread thread;
+        SQRAT_STD::function<bool(ScriptThread&)> start;
+        SQInteger generation = 0; // changes on every rescheduling, outdated heap items and waiters are skipped
+    };
+
+    struct HeapItem {
+        Clock::time_point deadline;
+        TaskId id;
+        SQInteger generation;
+
+        static bool Later(const HeapItem& a, const HeapItem& b) { return a.deadline > b.deadline; }
+    };
+
+    struct Waiter {
+        TaskId id;
+        SQInteger generation;
+    };
+
+    void MakeReady(TaskId id, TaskEntry& task, Clock::time_point deadline) {
+        ready.push_back(HeapItem{deadline, id, ++task.generation});
+        SQRAT_STD::push_heap(ready.begin(), ready.end(), HeapItem::Later);
+    }
+
+    void Run(TaskId id, TaskEntry& task) {
+        bool ok;
+        running = id;
+        if (task.start) {
+            ok = task.start(task.thread);
+            task.start = nullptr;
+        }
+        else
+            ok = task.thread.Resume();
+        running = 0;
+
+        if (killRunning) {
+            killRunning = false;
+            tasks.erase(id);
+            return;
+        }
+        Settle(id, task, ok);
+    }
+
+    // Schedules a task that stopped running according to its state
+    void Settle(TaskId id, TaskEntry& task, bool ok = true) {
+        if (task.thread.GetState() == ScriptThread::Failed)
+            ok = false;
+        if (!ok || !task.thread.IsSuspended()) {
+            if (ok)
+                ++stats.finished;
+            else
+                ++stats.failed;
+            tasks.erase(id);
+            return;
+        }
+
+        if (task.thread.IsWaitingExternally()) {
+            ++task.generation;
+            parked.push_back(id);
+            return;
+        }
+
+        // the value passed to suspend() tells what to wait for
+        const Object& request = task.thread.GetValue();
+        switch (request.GetType()) {
+            case OT_INTEGER:
+            case OT_FLOAT: {
+                SQFloat seconds = request.Cast<SQFloat>();
+                MakeReady(id, task, Clock::now() +
+                          SQRAT_STD::chrono::duration_cast<Clock::duration>(SQRAT_STD::chrono::duration<SQFloat>(seconds)));
+                break;
+            }
+            case OT_STRING:
+                waiters[request.Cast<string>()].push_back(Waiter{id, ++task.generation});
+                break;
+            default:
+                MakeReady(id, task, Clock::now());
+                break;
+        }
+    }
+
+    // Walks the part of the heap that is due: children are never due earlier than their parent
+    void CollectPending(size_t i, Clock::time_point tickStart, Clock::time_point now) {
+        if (i >= ready.size() || ready[i].deadline > tickStart)
+            return;
+        auto t = tasks.find(ready[i].id);
+        if (t != tasks.end() && t->second.generation == ready[i].generation) {
+            ++stats.pending;
+            if (now - ready[i].deadline > starvationThreshold)
+                starved.push_back(StarvedTask{ready[i].id, now - ready[i].deadline});
+        }
+        CollectPending(2 * i + 1, tickStart, now);
+        CollectPending(2 * i + 2, tickStart, now);
+    }
+
+    SQRAT_STD::unordered_map<TaskId, TaskEntry> tasks;
+    SQRAT_STD::vector<HeapItem> ready;
+    SQRAT_STD::unordered_map<string, SQRAT_STD::vector<Waiter>> waiters;
+    SQRAT_STD::vector<TaskId> parked; // waiting for native code to resume them
+    SQRAT_STD::vector<StarvedTask> starved;
+    TickStats stats;
+    TaskId nextId;
+    TaskId running;
+    bool killRunning;
+    Clock::duration starvationThreshold;
+};
+
+}
+
+#endif
@@ -33,6 +33,8 @@
 #include <sqstdio.h>
 #include <string.h>
 
+#include "sqratBytecodeCache.h"
+#include "sqratBytecodeImage.h"
 #include "sqratObject.h"
 
 
@@ -56,6 +58,7 @@ public:
     bool CompileString(const string_view &script, string &errMsg,
                        const string_view &name = string_view())
     {
+        image.reset();
         if(!sq_isnull(obj)) {
             sq_release(vm, &obj);
             sq_resetobject(&obj);
@@ -80,6 +83,7 @@ public:
     ///
     /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     bool CompileFile(const string& path, string& errMsg) {
+        image.reset();
         if(!sq_isnull(obj)) {
             sq_release(vm, &obj);
             sq_resetobject(&obj);
@@ -97,6 +101,140 @@ public:
     }
 
 
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Sets up the Script using a string containing a Squirrel script, reusing bytecode from the cache when possible
+    ///
+    /// \param script String containing a Squirrel script
+    /// \param errMsg String that is filled with any errors that may occur
+    /// \param name   String containing the script's name (for errors)
+    /// \param cache  Bytecode cache to load the compiled script from or store it to
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    bool CompileString(const string_view &script, string &errMsg, const string_view &name, BytecodeCache &cache)
+    {
+        image.reset();
+        if(!sq_isnull(obj)) {
+            sq_release(vm, &obj);
+            sq_resetobject(&obj);
+        }
+
+        if (!cache.Compile(vm, script, name, errMsg))
+            return false;
+
+        sq_getstackobj(vm,-1,&obj);
+        sq_addref(vm, &obj);
+        sq_pop(vm, 1);
+        return true;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Sets up the Script using a file containing a Squirrel script, reusing bytecode from the cache when possible
+    ///
+    /// \param path   File path containing a Squirrel script
+    /// \param errMsg String that is filled with any errors that may occur
+    /// \param cache  Bytecode cache to load the compiled script from or store it to
+    ///
+    /// \remarks
+    /// Files that can't be read as source text (precompiled bytecode, SQUNICODE builds) are loaded without the cache.
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    bool CompileFile(const string& path, string& errMsg, BytecodeCache& cache) {
+        string source;
+        if (!BytecodeCache::ReadFile(path, source) ||
+            (source.size() >= 2 && (unsigned char)source[0] == 0xFA && (unsigned char)source[1] == 0xFA))
+            return CompileFile(path, errMsg);
+
+        return CompileString(source, errMsg, path, cache);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Sets up the Script using a closure serialized with sq_writeclosure
+    ///
+    /// \param data   Serialized closure
+    /// \param size   Size of the data in bytes
+    /// \param errMsg String that is filled with any errors that may occur
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    bool LoadBytecode(const char* data, size_t size, string& errMsg) {
+        image.reset();
+        if(!sq_isnull(obj)) {
+            sq_release(vm, &obj);
+            sq_resetobject(&obj);
+        }
+
+        BytecodeMemoryReader reader{data, size};
+        if(SQ_FAILED(sq_readclosure(vm, &BytecodeMemoryReader::Read, &reader))) {
+            errMsg = LastErrorString(vm);
+            return false;
+        }
+
+        sq_getstackobj(vm,-1,&obj);
+        sq_addref(vm, &obj);
+        sq_pop(vm, 1);
+        return true;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Sets up the Script to use a compiled script from a bytecode image
+    ///
+    /// \param img  Mapped bytecode image
+    /// \param name Name of the script in the image
+    ///
+    /// \remarks
+    /// The closure is deserialized on the first Run(), until then the Script object is null. Fails if the image was
+    /// compiled with other constants than the ones of the VM (see BytecodeImage::IsCompatible()).
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    bool LoadFromImage(const shared_ptr<BytecodeImage>& img, const string& name) {
+        if(!sq_isnull(obj)) {
+            sq_release(vm, &obj);
+            sq_resetobject(&obj);
+        }
+        image.reset();
+        if (!img || !img->Contains(name) || !img->IsCompatible(vm))
+            return false;
+        image = img;
+        imageName = name;
+        return true;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Maps a bytecode image file and sets up the Script to use the named script from it
+    ///
+    /// \param path File path of the image
+    /// \param name Name of the script in the image
+    ///
+    /// \remarks
+    /// Open the image once with BytecodeImage::Open() and share it when loading several scripts from it.
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    bool LoadFromImage(const string& path, const string& name) {
+        return LoadFromImage(BytecodeImage::Open(path), name);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Deserializes the closure of a script set up with LoadFromImage(), does nothing for other scripts
+    ///
+    /// \param errMsg String that is filled with the error if the closure can't be read
+    ///
+    /// \remarks
+    /// Run() calls it; code running the closure some other way must call it first.
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    bool Materialize(string& errMsg) {
+        if(sq_isnull(obj) && image) {
+            if (!image->Materialize(vm, imageName)) {
+                errMsg = LastErrorString(vm);
+                return false;
+            }
+            sq_getstackobj(vm,-1,&obj);
+            sq_addref(vm, &obj);
+            sq_pop(vm, 1);
+            image.reset();
+        }
+        return true;
+    }
+
     /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     /// Runs the script
     ///
@@ -104,6 +242,8 @@ public:
     ///
     /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     bool Run(string& errMsg, Object * context = NULL) {
+        if(!Materialize(errMsg))
+            return false;
         if(!sq_isnull(obj)) {
             SQRESULT result;
             SQInteger top = sq_gettop(vm);
@@ -124,6 +264,10 @@ public:
         }
         return false;
     }
+
+private:
+    shared_ptr<BytecodeImage> image; // set until the script from the image is materialized
+    string imageName;
 };
 
 }
@@ -0,0 +1,720 @@
+// Sqrat: altered version by Gaijin Entertainment Corp.
+// sqratSerialize: Binary serialization of script values
+//
+
+//
+// Copyright (c) 2009 Brandon Jones
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//  claim that you wrote the original software. If you use this software
+//  in a product, an acknowledgment in the product documentation would be
+//  appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//  misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source
+//  distribution.
+//
+
+
+
+#pragma once
+#if !defined(_SQRAT_SERIALIZE_H_)
+#define _SQRAT_SERIALIZE_H_
+
+#include <squirrel.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <deque>
+
+#include "sqratClassType.h"
+#include "sqratObject.h"
+#include "sqratTypes.h"
+#include "sqratUtil.h"
+
+#if defined(SQRAT_HAS_EASTL)
+# include <EASTL/functional.h>
+# include <EASTL/vector.h>
+#else
+# include <functional>
+# include <vector>
+#endif
+
+namespace Sqrat {
+
+class Serializer;
+class Deserializer;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Serialization hooks of bound classes
+///
+/// \remarks
+/// Instances are written as the hook name followed by whatever the write hook stores, using the Serializer
+/// primitives or nested Write() calls. On reading, the hook with the same name must push a new instance.
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class SerializationRegistry {
+public:
+    typedef SQRAT_STD::function<bool(HSQUIRRELVM, SQInteger, Serializer&)> WriteFunc; ///< Writes the instance at the given index
+    typedef SQRAT_STD::function<bool(HSQUIRRELVM, Deserializer&)> ReadFunc;           ///< Pushes a new instance
+
+    struct Hook {
+        string name;
+        AbstractStaticClassData* (*typeTag)();
+        WriteFunc write;
+        ReadFunc read;
+    };
+
+    /// Adds hooks working on the Quirrel stack
+    template<class C>
+    SerializationRegistry& Add(const SQChar* name, const WriteFunc& write, const ReadFunc& read) {
+        Hook h;
+        h.name = name;
+        h.typeTag = &ClassType<C>::getStaticClassDataPtr;
+        h.write = write;
+        h.read = read;
+        hooks.push_back(h);
+        return *this;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Adds hooks for a copyable class
+    ///
+    /// \param name Name identifying the class in serialized data
+    /// \param save Writes the members of an instance
+    /// \param load Reads the members into a default constructed C, returns false on malformed data
+    ///
+    /// \remarks
+    /// Loaded values are pushed as copies (C must be bound with an allocator that supports copying).
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    template<class C>
+    SerializationRegistry& Add(const SQChar* name, void (*save)(const C&, Serializer&), bool (*load)(C&, Deserializer&)) {
+        return Add<C>(name,
+            [save](HSQUIRRELVM vm, SQInteger idx, Serializer& out) {
+                save(Var<const C&>(vm, idx).value, out);
+                return true;
+            },
+            [load](HSQUIRRELVM vm, Deserializer& in) {
+                C value;
+                if (!load(value, in))
+                    return false;
+                PushVar(vm, value);
+                return true;
+            });
+    }
+
+    const Hook* FindByTag(SQUserPointer tag) const {
+        if (!tag)
+            return nullptr;
+        for (const Hook& h : hooks)
+            if (h.typeTag() == tag)
+                return &h;
+        return nullptr;
+    }
+
+    const Hook* FindByName(const SQChar* name, size_t len) const {
+        for (const Hook& h : hooks)
+            if (h.name.size() == len && memcmp(h.name.data(), name, len * sizeof(SQChar)) == 0)
+                return &h;
+        return nullptr;
+    }
+
+private:
+    SQRAT_STD::vector<Hook> hooks;
+};
+
+/// Tags and limits of the serialized format
+struct SerializationFormat {
+    enum Tag {
+        TagNull = 0,
+        TagFalse,
+        TagTrue,
+        TagInteger,   ///< zigzag varint
+        TagFloat,     ///< raw SQFloat
+        TagString,    ///< varint length in SQChars, characters; gets the next string index
+        TagStringRef, ///< varint string index
+        TagTable,     ///< varint slot count, key/value pairs; gets the next object index
+        TagArray,     ///< varint element count, elements; gets the next object index
+        TagInstance,  ///< hook name (string), hook data; gets the next object index
+        TagObjectRef  ///< varint object index
+    };
+
+    static const unsigned char Version = 1;
+    static const size_t HeaderSize = 6; ///< "SQB", version, sizeof(SQChar), sizeof(SQFloat)
+    static const int MaxDepth = 512;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Writes script values into a contiguous buffer
+///
+/// \remarks
+/// Null, bools, integers, floats, strings, tables, arrays and instances of classes with hooks are supported.
+/// Tables, arrays and instances reachable more than once (including cycles) are written once and referenced
+/// afterwards; repeated strings are written once as well (script strings are interned, so they are matched by
+/// identity without hashing their contents). Both tables are kept across Write() calls until Reset(), so
+/// a sequence of values is a batch sharing them and must be read back in order by one Deserializer. Written objects
+/// and strings are kept referenced until the batch ends, so a temporary freed after Write() can't be replaced by a new
+/// one at the same address and mistaken for a reference.
+/// An instance can't refer back to itself (directly or through values its hook writes), since the reader creates it
+/// only after reading its data; such values fail to write.
+/// The format depends on SQChar and SQFloat sizes, so data is only portable between compatible builds.
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class Serializer {
+public:
+    explicit Serializer(const SerializationRegistry* classes = nullptr) : registry(classes) {
+        Reset();
+    }
+
+    /// Clears the buffer and starts a new batch
+    void Reset() {
+        buffer.clear();
+        strings.clear();
+        scriptStrings.clear();
+        stringPins.clear();
+        objects.clear();
+        pinned.clear();
+        openInstances.clear();
+        error.clear();
+        depth = 0;
+        const unsigned char header[SerializationFormat::HeaderSize] = {
+            'S', 'Q', 'B', SerializationFormat::Version, (unsigned char)sizeof(SQChar), (unsigned char)sizeof(SQFloat)
+        };
+        buffer.insert(buffer.end(), header, header + sizeof(header));
+    }
+
+    /// Appends the value at the given stack index, returns false (see GetError) if it holds unsupported values
+    bool Write(HSQUIRRELVM vm, SQInteger idx) {
+        if (idx < 0)
+            idx = sq_gettop(vm) + idx + 1;
+        if (depth > 0) // nested call from a serialization hook
+            return WriteValue(vm, idx);
+
+        // a failed value is removed so the batch stays readable
+        const size_t bufferSize = buffer.size(), stringCount = stringPins.size(), objectCount = objects.size();
+        error.clear();
+        if (WriteValue(vm, idx))
+            return true;
+        Rollback(bufferSize, stringCount, objectCount);
+        return false;
+    }
+
+    /// Appends the value of an Object
+    bool Write(const Object& o) {
+        HSQUIRRELVM vm = o.GetVM();
+        sq_pushobject(vm, o.GetObject());
+        bool ok = Write(vm, -1);
+        sq_pop(vm, 1); // pop value
+        return ok;
+    }
+
+    void WriteBool(bool b) {
+        Put(b ? SerializationFormat::TagTrue : SerializationFormat::TagFalse);
+    }
+
+    void WriteInteger(SQInteger i) {
+        Put(SerializationFormat::TagInteger);
+        PutVarint((uint64_t(i) << 1) ^ uint64_t(int64_t(i) >> 63));
+    }
+
+    void WriteFloat(SQFloat f) {
+        Put(SerializationFormat::TagFloat);
+        PutRaw(&f, sizeof(f));
+    }
+
+    void WriteString(const SQChar* s, size_t len) {
+        auto inserted = strings.insert(SQRAT_STD::make_pair(string(s, len), stringPins.size()));
+        if (!inserted.second) {
+            Put(SerializationFormat::TagStringRef);
+            PutVarint(inserted.first->second);
+            return;
+        }
+        stringPins.push_back(Object()); // nothing to keep, the key is a copy
+        PutString(s, len);
+    }
+
+    void WriteString(const string& s) {
+        WriteString(s.data(), s.size());
+    }
+
+    const SQRAT_STD::vector<unsigned char>& GetBuffer() const { return buffer; }
+
+    /// Moves the buffer out and starts a new batch
+    SQRAT_STD::vector<unsigned char> Release() {
+        SQRAT_STD::vector<unsigned char> out;
+        out.swap(buffer);
+        Reset();
+        return out;
+    }
+
+    const string& GetError() const { return error; }
+
+private:
+    void Put(unsigned char c) {
+        buffer.push_back(c);
+    }
+
+    void PutRaw(const void* p, size_t size) {
+        const unsigned char* b = static_cast<const unsigned char*>(p);
+        buffer.insert(buffer.end(), b, b + size);
+    }
+
+    void PutString(const SQChar* s, size_t len) {
+        Put(SerializationFormat::TagString);
+        PutVarint(len);
+        PutRaw(s, len * sizeof(SQChar));
+    }
+
+    void PutVarint(uint64_t v) {
+        while (v >= 0x80) {
+            buffer.push_back((unsigned char)(v | 0x80));
+            v >>= 7;
+        }
+        buffer.push_back((unsigned char)v);
+    }
+
+    bool Fail(const SQChar* msg) {
+        if (error.empty())
+            error = msg;
+        return false;
+    }
+
+    void Rollback(size_t bufferSize, size_t stringCount, size_t objectCount) {
+        buffer.resize(bufferSize);
+        for (auto it = strings.begin(); it != strings.end();)
+            it = it->second >= stringCount ? strings.erase(it) : SQRAT_STD::next(it);
+        for (auto it = scriptStrings.begin(); it != scriptStrings.end();)
+            it = it->second >= stringCount ? scriptStrings.erase(it) : SQRAT_STD::next(it);
+        stringPins.resize(stringCount, Object());
+        for (auto it = objects.begin(); it != objects.end();)
+            it = it->second >= objectCount ? objects.erase(it) : SQRAT_STD::next(it);
+        pinned.resize(objectCount, Object());
+        openInstances.clear();
+        depth = 0;
+    }
+
+
+    bool WriteValue(HSQUIRRELVM vm, SQInteger idx) {
+        switch (sq_gettype(vm, idx)) {
+        case OT_NULL:
+            Put(SerializationFormat::TagNull);
+            return true;
+        case OT_BOOL: {
+            SQBool b = SQFalse;
+            sq_getbool(vm, idx, &b);
+            WriteBool(b != SQFalse);
+            return true;
+        }
+        case OT_INTEGER: {
+            SQInteger i = 0;
+            sq_getinteger(vm, idx, &i);
+            WriteInteger(i);
+            return true;
+        }
+        case OT_FLOAT: {
+            SQFloat f = 0;
+            sq_getfloat(vm, idx, &f);
+            WriteFloat(f);
+            return true;
+        }
+        case OT_STRING:
+            WriteScriptString(vm, idx);
+            return true;
+        case OT_TABLE:
+        case OT_ARRAY:
+        case OT_INSTANCE:
+            return WriteContainer(vm, idx);
+        default:
+            return Fail(_SC("value type is not serializable"));
+        }
+    }
+
+    // Script strings are interned per VM, so the string object identifies the contents
+    void WriteScriptString(HSQUIRRELVM vm, SQInteger idx) {
+        HSQOBJECT o;
+        sq_getstackobj(vm, idx, &o);
+        auto inserted = scriptStrings.insert(SQRAT_STD::make_pair((const void*)o._unVal.pString, stringPins.size()));
+        if (!inserted.second) {
+            Put(SerializationFormat::TagStringRef);
+            PutVarint(inserted.first->second);
+            return;
+        }
+        stringPins.push_back(Object(o, vm));
+        const SQChar* s = nullptr;
+        SQInteger len = 0;
+        sq_getstringandsize(vm, idx, &s, &len);
+        PutString(s, size_t(len));
+    }
+
+    bool WriteContainer(HSQUIRRELVM vm, SQInteger idx) {
+        if (depth >= SerializationFormat::MaxDepth)
+            return Fail(_SC("values are nested too deep"));
+
+        HSQOBJECT o;
+        sq_getstackobj(vm, idx, &o);
+        const void* identity = sq_istable(o) ? (const void*)o._unVal.pTable
+                             : sq_isarray(o) ? (const void*)o._unVal.pArray
+                             : (const void*)o._unVal.pInstance;
+        auto it = objects.find(identity);
+        if (it != objects.end()) {
+            if (SQRAT_STD::find(openInstances.begin(), openInstances.end(), it->second) != openInstances.end())
+                return Fail(_SC("an instance refers to itself while being written"));
+            Put(SerializationFormat::TagObjectRef);
+            PutVarint(it->second);
+            return true;
+        }
+        const size_t index = objects.size();
+        objects[identity] = index;
+        pinned.push_back(Object(o, vm));
+
+        ++depth;
+        bool ok = true;
+        if (sq_isinstance(o)) {
+            SQUserPointer tag = nullptr;
+            sq_gettypetag(vm, idx, &tag);
+            const SerializationRegistry::Hook* hook = registry ? registry->FindByTag(tag) : nullptr;
+            if (!hook) {
+                --depth;
+                return Fail(_SC("no serialization hook for the class of an instance"));
+            }
+            Put(SerializationFormat::TagInstance);
+            WriteString(hook->name);
+            openInstances.push_back(index);
+            ok = hook->write(vm, idx, *this) || Fail(_SC("serialization hook failed"));
+            openInstances.pop_back();
+        } else {
+            Put(sq_istable(o) ? SerializationFormat::TagTable : SerializationFormat::TagArray);
+            PutVarint(uint64_t(sq_getsize(vm, idx)));
+            sq_pushnull(vm);
+            while (ok && SQ_SUCCEEDED(sq_next(vm, idx))) {
+                SQInteger top = sq_gettop(vm);
+                if (sq_istable(o))
+                    ok = WriteValue(vm, top - 1);
+                ok = ok && WriteValue(vm, top);
+                sq_pop(vm, 2); // pop key and value
+            }
+            sq_pop(vm, 1); // pop iterator
+        }
+        --depth;
+        return ok;
+    }
+
+    const SerializationRegistry* registry;
+    SQRAT_STD::vector<unsigned char> buffer;
+    SQRAT_STD::unordered_map<string, size_t> strings;             // written by hooks, by contents
+    SQRAT_STD::unordered_map<const void*, size_t> scriptStrings;  // by string object
+    SQRAT_STD::vector<Object> stringPins;                         // indexed like strings, script strings only
+    SQRAT_STD::unordered_map<const void*, size_t> objects;
+    SQRAT_STD::vector<Object> pinned;        // indexed like objects
+    SQRAT_STD::vector<size_t> openInstances; // instances whose hooks are running
+    string error;
+    int depth;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Reads values written by a Serializer, in order, pushing them onto a VM
+///
+/// \remarks
+/// Data is read straight from the given memory, which must stay valid while the Deserializer is used; strings are
+/// pushed from it without intermediate copies. Malformed or truncated data makes Read() fail without crashing.
+/// The objects read so far are kept referenced so later values of the batch can refer to them.
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class Deserializer {
+public:
+    Deserializer(const void* data, size_t size, const SerializationRegistry* classes = nullptr)
+        : registry(classes), p(static_cast<const unsigned char*>(data)), end(p + size), depth(0), headerRead(false) {}
+
+    /// Pushes the next value, returns false (pushing nothing, see GetError) on malformed data
+    bool Read(HSQUIRRELVM vm) {
+        if (!headerRead && !ReadHeader())
+            return false;
+        SQInteger top = sq_gettop(vm);
+        if (!ReadValue(vm)) {
+            sq_settop(vm, top);
+            return false;
+        }
+        return true;
+    }
+
+    /// Reads the next value into an Object
+    bool Read(HSQUIRRELVM vm, Object& out) {
+        if (!Read(vm))
+            return false;
+        HSQOBJECT o;
+        sq_getstackobj(vm, -1, &o);
+        out = Object(o, vm);
+        sq_pop(vm, 1); // pop value
+        return true;
+    }
+
+    bool AtEnd() const { return p == end; }
+
+    bool ReadBool(bool& b) {
+        if (p < end && (*p == SerializationFormat::TagTrue || *p == SerializationFormat::TagFalse)) {
+            b = *p++ == SerializationFormat::TagTrue;
+            return true;
+        }
+        return Fail(_SC("bool expected"));
+    }
+
+    bool ReadInteger(SQInteger& i) {
+        uint64_t v;
+        if (p >= end || *p != SerializationFormat::TagInteger)
+            return Fail(_SC("integer expected"));
+        ++p;
+        if (!GetVarint(v))
+            return false;
+        i = SQInteger(int64_t(v >> 1) ^ -int64_t(v & 1));
+        return true;
+    }
+
+    bool ReadFloat(SQFloat& f) {
+        if (p >= end || *p != SerializationFormat::TagFloat || size_t(end - p) < 1 + sizeof(SQFloat))
+            return Fail(_SC("float expected"));
+        memcpy(&f, p + 1, sizeof(SQFloat));
+        p += 1 + sizeof(SQFloat);
+        return true;
+    }
+
+    bool ReadString(string& s) {
+        const SQChar* chars;
+        size_t len;
+        if (!GetString(chars, len))
+            return false;
+        s.assign(chars, len);
+        return true;
+    }
+
+    const string& GetError() const { return error; }
+
+private:
+    bool Fail(const SQChar* msg) {
+        if (error.empty())
+            error = msg;
+        return false;
+    }
+
+    bool ReadHeader() {
+        if (size_t(end - p) < SerializationFormat::HeaderSize || p[0] != 'S' || p[1] != 'Q' || p[2] != 'B')
+            return Fail(_SC("not serialized data"));
+        if (p[3] != SerializationFormat::Version || p[4] != sizeof(SQChar) || p[5] != sizeof(SQFloat))
+            return Fail(_SC("serialized data is incompatible with this build"));
+        p += SerializationFormat::HeaderSize;
+        headerRead = true;
+        return true;
+    }
+
+    bool GetVarint(uint64_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 64 && p < end; shift += 7) {
+            unsigned char c = *p++;
+            v |= uint64_t(c & 0x7F) << shift;
+            if (!(c & 0x80))
+                return true;
+        }
+        return Fail(_SC("truncated data"));
+    }
+
+    bool GetCount(size_t& count) {
+        uint64_t v;
+        if (!GetVarint(v))
+            return false;
+        if (v > uint64_t(end - p)) // every element takes at least one byte
+            return Fail(_SC("invalid element count"));
+        count = size_t(v);
+        return true;
+    }
+
+    // Reads a TagString or TagStringRef, pointing into the buffer
+    bool GetString(const SQChar*& chars, size_t& len) {
+        if (p >= end)
+            return Fail(_SC("truncated data"));
+        unsigned char tag = *p++;
+        uint64_t v;
+        if (!GetVarint(v))
+            return false;
+        if (tag == SerializationFormat::TagStringRef) {
+            if (v >= strings.size())
+                return Fail(_SC("invalid string reference"));
+            chars = strings[size_t(v)].first;
+            len = strings[size_t(v)].second;
+            return true;
+        }
+        if (tag != SerializationFormat::TagString)
+            return Fail(_SC("string expected"));
+        if (v > uint64_t(end - p) / sizeof(SQChar))
+            return Fail(_SC("truncated data"));
+        len = size_t(v);
+#if defined(SQUNICODE)
+        wideCopies.push_back(string(len, 0)); // wide characters in the buffer may be unaligned
+        memcpy(&wideCopies.back()[0], p, len * sizeof(SQChar));
+        chars = wideCopies.back().data();
+#else
+        chars = reinterpret_cast<const SQChar*>(p);
+#endif
+        p += len * sizeof(SQChar);
+        strings.push_back(SQRAT_STD::make_pair(chars, len));
+        return true;
+    }
+
+    bool ReadValue(HSQUIRRELVM vm) {
+        if (p >= end)
+            return Fail(_SC("truncated data"));
+        switch (*p) {
+        case SerializationFormat::TagNull:
+            ++p;
+            sq_pushnull(vm);
+            return true;
+        case SerializationFormat::TagFalse:
+        case SerializationFormat::TagTrue:
+            sq_pushbool(vm, *p++ == SerializationFormat::TagTrue);
+            return true;
+        case SerializationFormat::TagInteger: {
+            SQInteger i;
+            if (!ReadInteger(i))
+                return false;
+            sq_pushinteger(vm, i);
+            return true;
+        }
+        case SerializationFormat::TagFloat: {
+            SQFloat f;
+            if (!ReadFloat(f))
+                return false;
+            sq_pushfloat(vm, f);
+            return true;
+        }
+        case SerializationFormat::TagString:
+        case SerializationFormat::TagStringRef: {
+            const SQChar* chars;
+            size_t len;
+            if (!GetString(chars, len))
+                return false;
+            sq_pushstring(vm, chars, SQInteger(len));
+            return true;
+        }
+        case SerializationFormat::TagObjectRef: {
+            ++p;
+            uint64_t v;
+            if (!GetVarint(v))
+                return false;
+            if (v >= objects.size() || objects[size_t(v)].IsNull())
+                return Fail(_SC("invalid object reference"));
+            sq_pushobject(vm, objects[size_t(v)].GetObject());
+            return true;
+        }
+        case SerializationFormat::TagTable:
+        case SerializationFormat::TagArray:
+        case SerializationFormat::TagInstance:
+            return ReadContainer(vm);
+        default:
+            return Fail(_SC("unknown tag"));
+        }
+    }
+
+    bool ReadContainer(HSQUIRRELVM vm) {
+        if (depth >= SerializationFormat::MaxDepth)
+            return Fail(_SC("values are nested too deep"));
+
+        unsigned char tag = *p++;
+        size_t index = objects.size();
+        objects.push_back(Object(vm)); // reserved, filled once the object exists
+        ++depth;
+        bool ok = true;
+
+        if (tag == SerializationFormat::TagInstance) {
+            const SQChar* name;
+            size_t len;
+            const SerializationRegistry::Hook* hook = nullptr;
+            ok = GetString(name, len);
+            if (ok && !(registry && (hook = registry->FindByName(name, len))))
+                ok = Fail(_SC("no serialization hook for a class in the data"));
+            SQInteger top = sq_gettop(vm);
+            ok = ok && hook->read(vm, *this);
+            if (ok && sq_gettop(vm) != top + 1)
+                ok = Fail(_SC("serialization hook must push one value"));
+        } else {
+            size_t count = 0;
+            ok = GetCount(count);
+            if (ok && tag == SerializationFormat::TagTable) {
+                sq_newtableex(vm, SQInteger(count));
+                Remember(vm, index);
+                for (size_t i = 0; ok && i < count; ++i) {
+                    ok = ReadValue(vm) && ReadValue(vm);
+                    ok = ok && SQ_SUCCEEDED(sq_newslot(vm, -3, SQFalse));
+                }
+            } else if (ok) {
+                sq_newarray(vm, SQInteger(count));
+                Remember(vm, index);
+                for (size_t i = 0; ok && i < count; ++i) {
+                    sq_pushinteger(vm, SQInteger(i));
+                    ok = ReadValue(vm) && SQ_SUCCEEDED(sq_rawset(vm, -3));
+                }
+            }
+        }
+
+        if (ok && tag == SerializationFormat::TagInstance)
+            Remember(vm, index);
+        --depth;
+        return ok;
+    }
+
+    void Remember(HSQUIRRELVM vm, size_t index) {
+        HSQOBJECT o;
+        sq_getstackobj(vm, -1, &o);
+        objects[index] = Object(o, vm);
+    }
+
+    const SerializationRegistry* registry;
+    const unsigned char* p;
+    const unsigned char* end;
+    SQRAT_STD::vector<SQRAT_STD::pair<const SQChar*, size_t> > strings;
+#if defined(SQUNICODE)
+    std::deque<string> wideCopies;
+#endif
+    SQRAT_STD::vector<Object> objects;
+    string error;
+    int depth;
+    bool headerRead;
+};
+
+/// Serializes a value into a new buffer, returns false (filling errMsg) if it holds unsupported values
+inline bool Serialize(const Object& value, SQRAT_STD::vector<unsigned char>& out, string& errMsg,
+                      const SerializationRegistry* classes = nullptr)
+{
+    Serializer s(classes);
+    if (!s.Write(value)) {
+        errMsg = s.GetError();
+        return false;
+    }
+    out = s.Release();
+    return true;
+}
+
+/// Deserializes a value written by Serialize(), returns false (filling errMsg) on malformed data
+inline bool Deserialize(HSQUIRRELVM vm, const void* data, size_t size, Object& out, string& errMsg,
+                        const SerializationRegistry* classes = nullptr)
+{
+    Deserializer d(data, size, classes);
+    if (!d.Read(vm, out)) {
+        errMsg = d.GetError();
+        return false;
+    }
+    return true;
+}
+
+}
+
+#endif
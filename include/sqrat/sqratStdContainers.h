@@ -0,0 +1,534 @@
+// Sqrat: altered version by Gaijin Entertainment Corp.
+// SqratStdContainers: Type Translators for standard containers
+//
+
+//
+// Copyright (c) 2009 Brandon Jones
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//  claim that you wrote the original software. If you use this software
+//  in a product, an acknowledgment in the product documentation would be
+//  appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//  misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source
+//  distribution.
+//
+
+#pragma once
+#if !defined(_SQRAT_STD_CONTAINERS_H_)
+#define _SQRAT_STD_CONTAINERS_H_
+
+#include <squirrel.h>
+#include <sqdirect.h>
+
+#include "sqratArray.h"
+#include "sqratTypes.h"
+#include "sqratUtil.h"
+
+#if defined(SQRAT_HAS_EASTL)
+# include <EASTL/vector.h>
+# include <EASTL/array.h>
+# include <EASTL/map.h>
+# include <EASTL/utility.h>
+# include <EASTL/tuple.h>
+# if __cplusplus >= 201703L
+# include <EASTL/optional.h>
+# include <EASTL/variant.h>
+# endif
+#else
+# include <vector>
+# include <array>
+# include <map>
+# include <utility>
+# if __cplusplus >= 201703L
+# include <optional>
+# include <variant>
+# endif
+#endif
+
+namespace Sqrat {
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Moves elements of type T between Squirrel arrays and C++ sequences
+///
+/// \remarks
+/// Integer and floating point elements go through BulkNumeric, other elements are converted with Var<T>.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename T, bool bulk = SQRAT_STD::is_arithmetic<T>::value && !SQRAT_STD::is_same<T, bool>::value>
+struct ArrayElements
+{
+    /// Returns the element at index i of the array arr (i must be valid)
+    static T Get(HSQUIRRELVM vm, const HSQOBJECT& arr, SQInteger i) {
+        HSQOBJECT key, elem;
+        sq_resetobject(&key);
+        key._type = OT_INTEGER;
+        key._unVal.nInteger = i;
+        SQRAT_VERIFY(SQ_SUCCEEDED(sq_direct_get(vm, &arr, &key, &elem, true)));
+        sq_pushobject(vm, elem);
+        T ret = Var<T>(vm, -1).value;
+        sq_pop(vm, 1);
+        return ret;
+    }
+
+    /// Reads count elements of the array arr into the sequence starting at dest
+    template <typename It>
+    static void Read(HSQUIRRELVM vm, const HSQOBJECT& arr, It dest, SQInteger count) {
+        for (SQInteger i = 0; i < count; ++i, ++dest)
+            *dest = Get(vm, arr, i);
+    }
+
+    /// Stores count elements starting at src into the array at stack index idx (the array must be large enough)
+    template <typename It>
+    static void Store(HSQUIRRELVM vm, SQInteger idx, It src, SQInteger count) {
+        ArrayBase::StoreRange(vm, idx, 0, src, count);
+    }
+};
+
+template <typename T>
+struct ArrayElements<T, true> : ArrayElements<T, false>
+{
+    using ArrayElements<T, false>::Read;
+    using ArrayElements<T, false>::Store;
+
+    static void Read(HSQUIRRELVM vm, const HSQOBJECT& arr, T* dest, SQInteger count) {
+        BulkNumeric<T>::Read(vm, arr, 0, dest, count);
+    }
+
+    static void Store(HSQUIRRELVM vm, SQInteger idx, const T* src, SQInteger count) {
+        BulkNumeric<T>::Write(vm, idx, 0, src, count);
+    }
+};
+
+
+/// Common part of Var specializations for containers marshaled as arrays
+template <class Container>
+struct SequenceVarBase {
+    static const SQChar * getVarTypeName() { return _SC("array"); }
+    static bool check_type(HSQUIRRELVM vm, SQInteger idx) {
+        return sq_gettype(vm, idx) == OT_ARRAY;
+    }
+
+protected:
+    static bool GetArray(HSQUIRRELVM vm, SQInteger idx, HSQOBJECT& arr, SQInteger& size) {
+        SQRAT_VERIFY(SQ_SUCCEEDED(sq_getstackobj(vm, idx, &arr)));
+        if (arr._type != OT_ARRAY) {
+            SQRAT_ASSERTF(arr._type == OT_NULL, FormatTypeError(vm, idx, _SC("array")).c_str());
+            return false;
+        }
+        size = sq_getsize(vm, idx);
+        return true;
+    }
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Used to get and push vectors to and from the stack as copies (marshaled as Squirrel arrays)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template<class T, class A>
+struct Var<SQRAT_STD::vector<T, A>> : SequenceVarBase<SQRAT_STD::vector<T, A>> {
+
+    SQRAT_STD::vector<T, A> value; ///< The actual value of get operations
+
+    /// Attempts to get the value off the stack at idx as a vector
+    Var(HSQUIRRELVM vm, SQInteger idx) {
+        HSQOBJECT arr;
+        SQInteger size = 0;
+        if (this->GetArray(vm, idx, arr, size)) {
+            value.resize(size);
+            ReadElements(vm, arr, size, SQRAT_STD::is_same<T, bool>());
+        }
+    }
+
+    /// Called by Sqrat::PushVar to put a vector on the stack
+    static void push(HSQUIRRELVM vm, const SQRAT_STD::vector<T, A>& value) {
+        SQInteger size = static_cast<SQInteger>(value.size());
+        sq_newarray(vm, size);
+        StoreElements(vm, value, size, SQRAT_STD::is_same<T, bool>());
+    }
+
+private:
+    void ReadElements(HSQUIRRELVM vm, const HSQOBJECT& arr, SQInteger size, SQRAT_STD::false_type) {
+        ArrayElements<T>::Read(vm, arr, value.data(), size);
+    }
+
+    void ReadElements(HSQUIRRELVM vm, const HSQOBJECT& arr, SQInteger size, SQRAT_STD::true_type) {
+        ArrayElements<T>::Read(vm, arr, value.begin(), size);
+    }
+
+    static void StoreElements(HSQUIRRELVM vm, const SQRAT_STD::vector<T, A>& value, SQInteger size, SQRAT_STD::false_type) {
+        ArrayElements<T>::Store(vm, -1, value.data(), size);
+    }
+
+    static void StoreElements(HSQUIRRELVM vm, const SQRAT_STD::vector<T, A>& value, SQInteger size, SQRAT_STD::true_type) {
+        ArrayElements<T>::Store(vm, -1, value.begin(), size);
+    }
+};
+
+template<class T, class A>
+struct Var<SQRAT_STD::vector<T, A>&> : Var<SQRAT_STD::vector<T, A>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<SQRAT_STD::vector<T, A>>(vm, idx) {}
+};
+
+template<class T, class A>
+struct Var<const SQRAT_STD::vector<T, A>&> : Var<SQRAT_STD::vector<T, A>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<SQRAT_STD::vector<T, A>>(vm, idx) {}
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Used to get and push fixed size arrays to and from the stack as copies (marshaled as Squirrel arrays)
+///
+/// \remarks
+/// When getting, extra elements of the Squirrel array are ignored and missing ones are left value-initialized.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template<class T, size_t N>
+struct Var<SQRAT_STD::array<T, N>> : SequenceVarBase<SQRAT_STD::array<T, N>> {
+
+    SQRAT_STD::array<T, N> value; ///< The actual value of get operations
+
+    /// Attempts to get the value off the stack at idx as an array
+    Var(HSQUIRRELVM vm, SQInteger idx) : value() {
+        HSQOBJECT arr;
+        SQInteger size = 0;
+        if (this->GetArray(vm, idx, arr, size))
+            ArrayElements<T>::Read(vm, arr, value.data(), size < SQInteger(N) ? size : SQInteger(N));
+    }
+
+    /// Called by Sqrat::PushVar to put an array on the stack
+    static void push(HSQUIRRELVM vm, const SQRAT_STD::array<T, N>& value) {
+        sq_newarray(vm, SQInteger(N));
+        ArrayElements<T>::Store(vm, -1, value.data(), SQInteger(N));
+    }
+};
+
+template<class T, size_t N>
+struct Var<SQRAT_STD::array<T, N>&> : Var<SQRAT_STD::array<T, N>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<SQRAT_STD::array<T, N>>(vm, idx) {}
+};
+
+template<class T, size_t N>
+struct Var<const SQRAT_STD::array<T, N>&> : Var<SQRAT_STD::array<T, N>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<SQRAT_STD::array<T, N>>(vm, idx) {}
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Used to get and push pairs to and from the stack as copies (marshaled as two element Squirrel arrays)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2>
+struct Var<SQRAT_STD::pair<T1, T2>> : SequenceVarBase<SQRAT_STD::pair<T1, T2>> {
+
+    SQRAT_STD::pair<T1, T2> value; ///< The actual value of get operations
+
+    /// Attempts to get the value off the stack at idx as a pair
+    Var(HSQUIRRELVM vm, SQInteger idx) : value() {
+        HSQOBJECT arr;
+        SQInteger size = 0;
+        if (this->GetArray(vm, idx, arr, size)) {
+            SQRAT_ASSERTF(size == 2, "array size mismatch (2 expected)");
+            if (size > 0)
+                value.first = ArrayElements<T1>::Get(vm, arr, 0);
+            if (size > 1)
+                value.second = ArrayElements<T2>::Get(vm, arr, 1);
+        }
+    }
+
+    /// Called by Sqrat::PushVar to put a pair on the stack
+    static void push(HSQUIRRELVM vm, const SQRAT_STD::pair<T1, T2>& value) {
+        sq_newarray(vm, 2);
+        sq_pushinteger(vm, 0);
+        PushVar(vm, value.first);
+        SQRAT_VERIFY(SQ_SUCCEEDED(sq_rawset(vm, -3)));
+        sq_pushinteger(vm, 1);
+        PushVar(vm, value.second);
+        SQRAT_VERIFY(SQ_SUCCEEDED(sq_rawset(vm, -3)));
+    }
+};
+
+template<class T1, class T2>
+struct Var<SQRAT_STD::pair<T1, T2>&> : Var<SQRAT_STD::pair<T1, T2>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<SQRAT_STD::pair<T1, T2>>(vm, idx) {}
+};
+
+template<class T1, class T2>
+struct Var<const SQRAT_STD::pair<T1, T2>&> : Var<SQRAT_STD::pair<T1, T2>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<SQRAT_STD::pair<T1, T2>>(vm, idx) {}
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Used to get and push tuples to and from the stack as copies (marshaled as Squirrel arrays)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template<class... T>
+struct Var<SQRAT_STD::tuple<T...>> : SequenceVarBase<SQRAT_STD::tuple<T...>> {
+
+    SQRAT_STD::tuple<T...> value; ///< The actual value of get operations
+
+    /// Attempts to get the value off the stack at idx as a tuple
+    Var(HSQUIRRELVM vm, SQInteger idx) : value() {
+        HSQOBJECT arr;
+        SQInteger size = 0;
+        if (this->GetArray(vm, idx, arr, size)) {
+            SQRAT_ASSERTF(size == SQInteger(sizeof...(T)), "array size mismatch");
+            ReadElements(vm, arr, size, SQRAT_STD::index_sequence_for<T...>());
+        }
+    }
+
+    /// Called by Sqrat::PushVar to put a tuple on the stack
+    static void push(HSQUIRRELVM vm, const SQRAT_STD::tuple<T...>& value) {
+        sq_newarray(vm, SQInteger(sizeof...(T)));
+        StoreElements(vm, value, SQRAT_STD::index_sequence_for<T...>());
+    }
+
+private:
+    template <size_t... I>
+    void ReadElements(HSQUIRRELVM vm, const HSQOBJECT& arr, SQInteger size, SQRAT_STD::index_sequence<I...>) {
+        SQRAT_UNUSED(vm);
+        SQRAT_UNUSED(arr);
+        SQRAT_UNUSED(size);
+        int expand[] = {0, ((SQInteger(I) < size ? (void)(SQRAT_STD::get<I>(value) = ArrayElements<T>::Get(vm, arr, I)) : (void)0), 0)...};
+        SQRAT_UNUSED(expand);
+    }
+
+    template <size_t... I>
+    static void StoreElements(HSQUIRRELVM vm, const SQRAT_STD::tuple<T...>& value, SQRAT_STD::index_sequence<I...>) {
+        SQRAT_UNUSED(value);
+        int expand[] = {0, (StoreElement(vm, SQInteger(I), SQRAT_STD::get<I>(value)), 0)...};
+        SQRAT_UNUSED(expand);
+    }
+
+    template <class E>
+    static void StoreElement(HSQUIRRELVM vm, SQInteger i, const E& elem) {
+        sq_pushinteger(vm, i);
+        PushVar(vm, elem);
+        SQRAT_VERIFY(SQ_SUCCEEDED(sq_rawset(vm, -3)));
+    }
+};
+
+template<class... T>
+struct Var<SQRAT_STD::tuple<T...>&> : Var<SQRAT_STD::tuple<T...>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<SQRAT_STD::tuple<T...>>(vm, idx) {}
+};
+
+template<class... T>
+struct Var<const SQRAT_STD::tuple<T...>&> : Var<SQRAT_STD::tuple<T...>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<SQRAT_STD::tuple<T...>>(vm, idx) {}
+};
+
+
+/// Common part of Var specializations for associative containers marshaled as tables
+template <class Map>
+struct MapVarBase {
+
+    Map value; ///< The actual value of get operations
+
+    /// Attempts to get the value off the stack at idx as a map
+    MapVarBase(HSQUIRRELVM vm, SQInteger idx) {
+        SQObjectType value_type = sq_gettype(vm, idx);
+        if (value_type != OT_TABLE) {
+            SQRAT_ASSERTF(value_type == OT_NULL, FormatTypeError(vm, idx, _SC("table")).c_str());
+            return;
+        }
+        ReserveFor(value, sq_getsize(vm, idx));
+        sq_push(vm, idx);
+        sq_pushnull(vm);
+        while (SQ_SUCCEEDED(sq_next(vm, -2))) {
+            Var<typename Map::key_type> key(vm, -2);
+            Var<typename Map::mapped_type> val(vm, -1);
+            value.emplace(SQRAT_STD::move(key.value), SQRAT_STD::move(val.value));
+            sq_pop(vm, 2);
+        }
+        sq_pop(vm, 2); // pops the null iterator and the table
+    }
+
+    /// Called by Sqrat::PushVar to put a map on the stack
+    static void push(HSQUIRRELVM vm, const Map& value) {
+        sq_newtableex(vm, static_cast<SQInteger>(value.size()));
+        for (const auto& kv : value) {
+            PushVar(vm, kv.first);
+            PushVar(vm, kv.second);
+            SQRAT_VERIFY(SQ_SUCCEEDED(sq_newslot(vm, -3, false)));
+        }
+    }
+
+    static const SQChar * getVarTypeName() { return _SC("table"); }
+    static bool check_type(HSQUIRRELVM vm, SQInteger idx) {
+        return sq_gettype(vm, idx) == OT_TABLE;
+    }
+
+private:
+    template <class M>
+    static auto ReserveFor(M& m, SQInteger size) -> decltype(m.reserve(size_t(size)), void()) {
+        m.reserve(size_t(size));
+    }
+
+    template <class M>
+    static void ReserveFor(M&, ...) {
+    }
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Used to get and push maps to and from the stack as copies (marshaled as Squirrel tables)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template<class K, class V, class C, class A>
+struct Var<SQRAT_STD::map<K, V, C, A>> : MapVarBase<SQRAT_STD::map<K, V, C, A>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : MapVarBase<SQRAT_STD::map<K, V, C, A>>(vm, idx) {}
+};
+
+template<class K, class V, class C, class A>
+struct Var<SQRAT_STD::map<K, V, C, A>&> : Var<SQRAT_STD::map<K, V, C, A>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<SQRAT_STD::map<K, V, C, A>>(vm, idx) {}
+};
+
+template<class K, class V, class C, class A>
+struct Var<const SQRAT_STD::map<K, V, C, A>&> : Var<SQRAT_STD::map<K, V, C, A>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<SQRAT_STD::map<K, V, C, A>>(vm, idx) {}
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Used to get and push unordered maps to and from the stack as copies (marshaled as Squirrel tables)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template<class K, class V, class H, class E, class A>
+struct Var<SQRAT_STD::unordered_map<K, V, H, E, A>> : MapVarBase<SQRAT_STD::unordered_map<K, V, H, E, A>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : MapVarBase<SQRAT_STD::unordered_map<K, V, H, E, A>>(vm, idx) {}
+};
+
+template<class K, class V, class H, class E, class A>
+struct Var<SQRAT_STD::unordered_map<K, V, H, E, A>&> : Var<SQRAT_STD::unordered_map<K, V, H, E, A>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<SQRAT_STD::unordered_map<K, V, H, E, A>>(vm, idx) {}
+};
+
+template<class K, class V, class H, class E, class A>
+struct Var<const SQRAT_STD::unordered_map<K, V, H, E, A>&> : Var<SQRAT_STD::unordered_map<K, V, H, E, A>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<SQRAT_STD::unordered_map<K, V, H, E, A>>(vm, idx) {}
+};
+
+
+#if __cplusplus >= 201703L
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Used to get and push optional values to and from the stack (an empty optional is null)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template<class T>
+struct Var<SQRAT_STD::optional<T>> {
+
+    SQRAT_STD::optional<T> value; ///< The actual value of get operations
+
+    /// Attempts to get the value off the stack at idx as an optional
+    Var(HSQUIRRELVM vm, SQInteger idx) {
+        if (sq_gettype(vm, idx) != OT_NULL)
+            value = Var<T>(vm, idx).value;
+    }
+
+    /// Called by Sqrat::PushVar to put an optional on the stack
+    static void push(HSQUIRRELVM vm, const SQRAT_STD::optional<T>& value) {
+        if (value)
+            PushVar(vm, *value);
+        else
+            sq_pushnull(vm);
+    }
+
+    static const SQChar * getVarTypeName() { return Var<T>::getVarTypeName(); }
+    static bool check_type(HSQUIRRELVM vm, SQInteger idx) {
+        return sq_gettype(vm, idx) == OT_NULL || Var<T>::check_type(vm, idx);
+    }
+};
+
+template<class T>
+struct Var<SQRAT_STD::optional<T>&> : Var<SQRAT_STD::optional<T>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<SQRAT_STD::optional<T>>(vm, idx) {}
+};
+
+template<class T>
+struct Var<const SQRAT_STD::optional<T>&> : Var<SQRAT_STD::optional<T>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<SQRAT_STD::optional<T>>(vm, idx) {}
+};
+
+
+/// Tells whether the value at idx has exactly the Squirrel type that T is pushed as
+template <class T>
+struct VariantAlternative {
+    static bool exact_type(HSQUIRRELVM vm, SQInteger idx) {
+        SQObjectType type = sq_gettype(vm, idx);
+        if (SQRAT_STD::is_same<T, bool>::value)
+            return type == OT_BOOL;
+        if (SQRAT_STD::is_integral<T>::value || SQRAT_STD::is_enum<T>::value)
+            return type == OT_INTEGER;
+        if (SQRAT_STD::is_floating_point<T>::value)
+            return type == OT_FLOAT;
+        return Var<T>::check_type(vm, idx);
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Used to get and push variants to and from the stack
+///
+/// \remarks
+/// When getting, the first alternative whose Squirrel type matches exactly is picked; if there is none, the first
+/// alternative whose Var::check_type accepts the value is used (e.g. an integer for a float alternative).
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template<class... T>
+struct Var<SQRAT_STD::variant<T...>> {
+
+    SQRAT_STD::variant<T...> value; ///< The actual value of get operations
+
+    /// Attempts to get the value off the stack at idx as a variant
+    Var(HSQUIRRELVM vm, SQInteger idx) {
+        if (!Get<true, 0, T...>(vm, idx) && !Get<false, 0, T...>(vm, idx))
+            SQRAT_ASSERTF(0, FormatTypeError(vm, idx, getVarTypeName()).c_str());
+    }
+
+    /// Called by Sqrat::PushVar to put a variant on the stack
+    static void push(HSQUIRRELVM vm, const SQRAT_STD::variant<T...>& value) {
+        SQRAT_STD::visit([vm](const auto& alt) { PushVar(vm, alt); }, value);
+    }
+
+    static const SQChar * getVarTypeName() { return _SC("variant"); }
+    static bool check_type(HSQUIRRELVM vm, SQInteger idx) {
+        return (Var<T>::check_type(vm, idx) || ...);
+    }
+
+private:
+    template <bool exact, size_t I, class Head, class... Tail>
+    bool Get(HSQUIRRELVM vm, SQInteger idx) {
+        if (exact ? VariantAlternative<Head>::exact_type(vm, idx) : Var<Head>::check_type(vm, idx)) {
+            value.template emplace<I>(Var<Head>(vm, idx).value);
+            return true;
+        }
+        return Get<exact, I + 1, Tail...>(vm, idx);
+    }
+
+    template <bool exact, size_t I>
+    bool Get(HSQUIRRELVM, SQInteger) {
+        return false;
+    }
+};
+
+template<class... T>
+struct Var<SQRAT_STD::variant<T...>&> : Var<SQRAT_STD::variant<T...>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<SQRAT_STD::variant<T...>>(vm, idx) {}
+};
+
+template<class... T>
+struct Var<const SQRAT_STD::variant<T...>&> : Var<SQRAT_STD::variant<T...>> {
+    Var(HSQUIRRELVM vm, SQInteger idx) : Var<SQRAT_STD::variant<T...>>(vm, idx) {}
+};
+
+#endif // __cplusplus >= 201703L
+
+}
+
+#endif
@@ -90,6 +90,24 @@ public:
         return *this;
     }
 
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Sets a key in the Table for every (key, value) pair of a C++ range (e.g. std::map or a vector of pairs)
+    ///
+    /// \remarks
+    /// The Table is pushed once for the whole range. Create the Table with Table::WithCapacity to avoid rehashing.
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    template<class Range>
+    TableBase& SetValues(const Range& range) {
+        sq_pushobject(vm, GetObject());
+        for (const auto& kv : range) {
+            PushVar(vm, kv.first);
+            PushVar(vm, kv.second);
+            SQRAT_VERIFY(SQ_SUCCEEDED(sq_newslot(vm, -3, false)));
+        }
+        sq_pop(vm,1); // pop table
+        return *this;
+    }
+
     template<class V>
     TableBase& SetInstance(const SQChar* name, V* val) {
         BindInstance<V>(name, val, false);
@@ -309,6 +327,17 @@ public:
 
     Table(HSQOBJECT o, HSQUIRRELVM v) : TableBase(o, v) {
     }
+
+    /// Creates a Table with storage preallocated for the given amount of slots
+    static Table WithCapacity(HSQUIRRELVM v, SQInteger capacity) {
+        SQRAT_ASSERT(v);
+        HSQOBJECT o;
+        sq_newtableex(v, capacity);
+        SQRAT_VERIFY(SQ_SUCCEEDED(sq_getstackobj(v, -1, &o)));
+        Table ret(o, v); // must addref before the pop!
+        sq_pop(v, 1);
+        return ret;
+    }
 };
 
 
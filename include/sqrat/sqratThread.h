@@ -0,0 +1,224 @@
+// Sqrat: altered version by Gaijin Entertainment Corp.
+// sqratThread: Quirrel threads driven from C++
+//
+
+//
+// Copyright (c) 2009 Brandon Jones
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//  claim that you wrote the original software. If you use this software
+//  in a product, an acknowledgment in the product documentation would be
+//  appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//  misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source
+//  distribution.
+//
+
+
+#pragma once
+#if !defined(_SQRAT_THREAD_H_)
+#define _SQRAT_THREAD_H_
+
+#include <squirrel.h>
+
+#include "sqratFunction.h"
+#include "sqratObject.h"
+#include "sqratTypes.h"
+#include "sqratUtil.h"
+
+#include <mutex>
+
+namespace Sqrat {
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Quirrel thread (coroutine) running a Function, resumed from C++
+///
+/// \remarks
+/// The thread is created with sq_newthread and kept alive by this object. Start() runs the function until it returns
+/// or suspends (suspend() in script, sq_suspendvm() in a native function), Resume() continues it. The value returned
+/// or passed to suspend() is available through GetValue(). ScriptThread is a shared handle: copies refer to the same
+/// thread.
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class ScriptThread {
+public:
+    enum State {
+        NotStarted,
+        Suspended,
+        Finished,
+        Failed
+    };
+
+    ScriptThread() {}
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Creates a thread that will run a function
+    ///
+    /// \param func      Function to run
+    /// \param stackSize Initial stack size of the thread
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    explicit ScriptThread(const Function& func, SQInteger stackSize = 1024) : data(new ThreadData(func, stackSize)) {
+        Threads::Add(data->thread, data);
+    }
+
+    /// Returns the ScriptThread running in the given thread VM (empty if it was not created by ScriptThread)
+    static ScriptThread FromVM(HSQUIRRELVM thread) {
+        ScriptThread t;
+        t.data = Threads::Find(thread);
+        return t;
+    }
+
+    bool IsNull() const { return !data; }
+    State GetState() const { return data ? data->state : Failed; }
+    bool IsSuspended() const { return GetState() == Suspended; }
+    bool IsFinished() const { return GetState() == Finished; }
+
+    /// Marks the thread as suspended by native code that will resume it itself (AsyncFunc() does), until it resumes
+    void WaitExternally() {
+        if (data)
+            data->waitingExternally = true;
+    }
+
+    /// True if the thread was suspended by WaitExternally() native code and is not to be resumed by anyone else
+    bool IsWaitingExternally() const { return data && data->waitingExternally; }
+
+    /// Value returned by the function or passed to suspend() the last time the thread stopped
+    const Object& GetValue() const { return data->value; }
+
+    HSQUIRRELVM GetThreadVM() const { return data ? data->thread : nullptr; }
+    HSQOBJECT GetThreadObject() const { return data->threadObj; }
+
+    /// Calls the function with the given arguments, returns false if the call failed
+    template <typename... Args>
+    bool Start(Args const&... args) {
+        if (!data || data->state != NotStarted)
+            return false;
+        HSQUIRRELVM t = data->thread;
+        sq_pushobject(t, data->func.GetFunc());
+        sq_pushobject(t, data->func.GetEnv());
+        int dummy[] = {0, (PushVar(t, args), 0)...};
+        (void)dummy;
+        return data->Update(SQ_SUCCEEDED(sq_call(t, sizeof...(Args) + 1, SQTrue, SQTrue)));
+    }
+
+    /// Resumes a suspended thread, suspend() returns null in script
+    bool Resume() {
+        if (!IsSuspended())
+            return false;
+        data->waitingExternally = false;
+        return data->Update(SQ_SUCCEEDED(sq_wakeupvm(data->thread, SQFalse, SQTrue, SQTrue, SQFalse)));
+    }
+
+    /// Resumes a suspended thread, suspend() (or the suspending native function) returns the given value in script
+    template <class T>
+    bool Resume(const T& value) {
+        if (!IsSuspended())
+            return false;
+        PushVar(data->thread, value);
+        return ResumeWithTop();
+    }
+
+    /// Resumes a suspended thread with the value on top of its stack as the result of suspend()
+    bool ResumeWithTop() {
+        if (!IsSuspended())
+            return false;
+        data->waitingExternally = false;
+        return data->Update(SQ_SUCCEEDED(sq_wakeupvm(data->thread, SQTrue, SQTrue, SQTrue, SQFalse)));
+    }
+
+private:
+    struct ThreadData {
+        Function func;
+        HSQUIRRELVM vm;
+        HSQUIRRELVM thread;
+        HSQOBJECT threadObj;
+        Object value;
+        State state;
+        bool waitingExternally;
+
+        ThreadData(const Function& f, SQInteger stackSize) : func(f), vm(f.GetVM()), state(NotStarted), waitingExternally(false) {
+            thread = sq_newthread(vm, stackSize);
+            SQRAT_VERIFY(SQ_SUCCEEDED(sq_getstackobj(vm, -1, &threadObj)));
+            sq_addref(vm, &threadObj);
+            sq_poptop(vm);
+        }
+
+        ~ThreadData() {
+            Threads::Remove(thread);
+            value.Release();
+            sq_release(vm, &threadObj);
+        }
+
+        ThreadData(const ThreadData&) = delete;
+        ThreadData& operator=(const ThreadData&) = delete;
+
+        // Called after the thread stopped running, the result of sq_call()/sq_wakeupvm() is on top of its stack
+        bool Update(bool succeeded) {
+            if (!succeeded) {
+                state = Failed;
+                value.Release();
+                sq_settop(thread, 0);
+                return false;
+            }
+            HSQOBJECT ret;
+            sq_getstackobj(thread, -1, &ret);
+            value = Object(ret, vm);
+            sq_poptop(thread);
+            if (sq_getvmstate(thread) == SQ_VMSTATE_SUSPENDED)
+                state = Suspended;
+            else {
+                state = Finished;
+                sq_settop(thread, 0);
+            }
+            return true;
+        }
+    };
+
+    // Maps thread VMs back to their ScriptThread for native functions that suspend the calling thread
+    struct Threads {
+        static void Add(HSQUIRRELVM thread, const shared_ptr<ThreadData>& d) {
+            std::lock_guard<std::mutex> lock(Mutex());
+            Map()[thread] = d;
+        }
+
+        static void Remove(HSQUIRRELVM thread) {
+            std::lock_guard<std::mutex> lock(Mutex());
+            Map().erase(thread);
+        }
+
+        static shared_ptr<ThreadData> Find(HSQUIRRELVM thread) {
+            std::lock_guard<std::mutex> lock(Mutex());
+            auto it = Map().find(thread);
+            return it != Map().end() ? it->second.lock() : shared_ptr<ThreadData>();
+        }
+
+    private:
+        static std::mutex& Mutex() {
+            static std::mutex mutex;
+            return mutex;
+        }
+
+        static SQRAT_STD::unordered_map<HSQUIRRELVM, weak_ptr<ThreadData>>& Map() {
+            static SQRAT_STD::unordered_map<HSQUIRRELVM, weak_ptr<ThreadData>> map;
+            return map;
+        }
+    };
+
+    shared_ptr<ThreadData> data;
+};
+
+}
+
+#endif
@@ -158,16 +158,103 @@ struct VarControlsValueLifeTime
 
 template<class Callable> SQFUNCTION SqGlobalThunk();
 
+// Callable types that wrap a Quirrel function and have their own Var specialization (see sqratCallback.h)
+template<typename T>
+struct is_script_callable_handle : SQRAT_STD::false_type {};
+
+// Per-VM cache of native closures created for stateless callables, kept in the registry table.
+// Closures are keyed by thunk, and for plain function pointers also by the function address.
+struct NativeClosureCache {
+    static SQUserPointer slotKey() {
+        static int slot_id_helper = 0;
+        return &slot_id_helper;
+    }
+
+    // Pushes the cached closure and returns true, or pushes nothing and returns false
+    static bool Push(HSQUIRRELVM vm, SQFUNCTION thunk, SQUserPointer funcKey) {
+        SQInteger top = sq_gettop(vm);
+        sq_pushregistrytable(vm);
+        sq_pushuserpointer(vm, slotKey());
+        bool found = SQ_SUCCEEDED(sq_rawget(vm, -2));
+        if (found) {
+            sq_pushuserpointer(vm, reinterpret_cast<SQUserPointer>(thunk));
+            found = SQ_SUCCEEDED(sq_rawget(vm, -2));
+        }
+        if (found && funcKey) {
+            sq_pushuserpointer(vm, funcKey);
+            found = SQ_SUCCEEDED(sq_rawget(vm, -2));
+        }
+        HSQOBJECT closure;
+        if (found)
+            sq_getstackobj(vm, -1, &closure);
+        sq_settop(vm, top);
+        if (found)
+            sq_pushobject(vm, closure); // still referenced by the cache
+        return found;
+    }
+
+    // Adds the closure on top of the stack to the cache, the closure stays on the stack
+    static void Store(HSQUIRRELVM vm, SQFUNCTION thunk, SQUserPointer funcKey) {
+        SQInteger top = sq_gettop(vm);
+        HSQOBJECT closure;
+        sq_getstackobj(vm, -1, &closure);
+        sq_pushregistrytable(vm);
+        PushSubTable(vm, slotKey());
+        if (funcKey) {
+            PushSubTable(vm, reinterpret_cast<SQUserPointer>(thunk));
+            sq_pushuserpointer(vm, funcKey);
+        }
+        else
+            sq_pushuserpointer(vm, reinterpret_cast<SQUserPointer>(thunk));
+        sq_pushobject(vm, closure);
+        SQRAT_VERIFY(SQ_SUCCEEDED(sq_rawset(vm, -3)));
+        sq_settop(vm, top);
+    }
+
+private:
+    // Pushes the table stored in the table on top of the stack under key, creating it if needed
+    static void PushSubTable(HSQUIRRELVM vm, SQUserPointer key) {
+        sq_pushuserpointer(vm, key);
+        if (SQ_FAILED(sq_rawget(vm, -2))) {
+            sq_newtable(vm);
+            sq_pushuserpointer(vm, key);
+            sq_push(vm, -2);
+            SQRAT_VERIFY(SQ_SUCCEEDED(sq_rawset(vm, -4)));
+        }
+    }
+};
+
 template<typename Func>
-struct Var<Func, SQRAT_STD::enable_if_t<is_callable_v<Func>>>
+struct Var<Func, SQRAT_STD::enable_if_t<is_callable_v<Func> && !is_script_callable_handle<Func>::value>>
 {
+  static constexpr bool isFuncPtr = SQRAT_STD::is_pointer<Func>::value &&
+                                    SQRAT_STD::is_function<remove_pointer_t<Func>>::value;
+  // Function pointers and captureless lambdas don't need a closure of their own for every push
+  static constexpr bool isStateless = isFuncPtr || SQRAT_STD::is_empty<Func>::value;
+
   static void push(HSQUIRRELVM vm, const Func& value)
   {
     SQFUNCTION funcThunk = SqGlobalThunk<Func>();
+    SQUserPointer funcKey = CacheKey(value, SQRAT_STD::integral_constant<bool, isFuncPtr>());
+    if (isStateless && NativeClosureCache::Push(vm, funcThunk, funcKey))
+      return;
+
     SQUserPointer funcPtr = sq_newuserdata(vm, sizeof(Func));
     new (funcPtr) Func(value);
     sq_setreleasehook(vm, -1, ImplaceFreeReleaseHook<Func>);
     sq_newclosure(vm, funcThunk, 1);
+
+    if (isStateless)
+      NativeClosureCache::Store(vm, funcThunk, funcKey);
+  }
+
+private:
+  static SQUserPointer CacheKey(const Func& value, SQRAT_STD::true_type) {
+    return reinterpret_cast<SQUserPointer>(value);
+  }
+
+  static SQUserPointer CacheKey(const Func&, SQRAT_STD::false_type) {
+    return nullptr;
   }
 };
 
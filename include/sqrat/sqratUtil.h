@@ -65,6 +65,7 @@
 # include <EASTL/unordered_set.h>
 # include <EASTL/vector_map.h>
 # include <EASTL/shared_ptr.h>
+# include <EASTL/iterator.h>
 EA_DISABLE_ALL_VC_WARNINGS()
 #else
 # include <string>
@@ -72,10 +73,15 @@ EA_DISABLE_ALL_VC_WARNINGS()
 # include <unordered_set>
 # include <memory>
 # include <tuple>
+# include <iterator>
 # include <type_traits>
 # if __cplusplus >= 201703L
 # include <string_view>
 # endif
+# if __cplusplus >= 202002L
+# include <span>
+# define SQRAT_HAS_SPAN 1
+# endif
 #endif
 
 #ifdef SQUNICODE
@@ -104,6 +110,10 @@ namespace Sqrat {
 #else
   using string_view = string;
 #endif
+
+#if defined(SQRAT_HAS_SPAN)
+  template <class T> using span = std::span<T>;
+#endif
 #endif //defined(SQRAT_HAS_EASTL)
 
 #if defined(SQRAT_HAS_SKA_HASH_MAP)
@@ -0,0 +1,261 @@
+// Sqrat: altered version by Gaijin Entertainment Corp.
+// sqratVMPool: Pool of pre-bound VMs
+//
+
+//
+// Copyright (c) 2009 Brandon Jones
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//  claim that you wrote the original software. If you use this software
+//  in a product, an acknowledgment in the product documentation would be
+//  appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//  misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source
+//  distribution.
+//
+
+
+
+#pragma once
+#if !defined(_SQRAT_VM_POOL_H_)
+#define _SQRAT_VM_POOL_H_
+
+#include <squirrel.h>
+
+#include "sqratUtil.h"
+
+#if defined(SQRAT_HAS_EASTL)
+# include <EASTL/vector.h>
+# include <EASTL/functional.h>
+#else
+# include <vector>
+# include <functional>
+#endif
+
+#include <mutex>
+
+namespace Sqrat {
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Pool of VMs that are bound once and reset to that state between uses
+///
+/// \remarks
+/// A VM is created with sq_open and prepared by the setup function (binding classes, constants and functions,
+/// running boot scripts). The root and const tables are then cloned as the baseline. When a lease ends the VM is
+/// reset by restoring the slots of both tables from the baseline, which is much cheaper than creating and binding a
+/// new VM. The restore is shallow: the tables keep their identity and their original slots, but objects referenced
+/// from them (nested tables, class statics, the registry table) keep whatever a script did to them.
+///
+/// The pool is thread safe; a leased VM belongs to the thread using it. The pool must outlive its leases.
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class VMPool {
+public:
+    typedef SQRAT_STD::function<void(HSQUIRRELVM)> SetupFunc;
+
+    struct Stats {
+        SQInteger hits = 0;      ///< Acquire() served by an idle VM
+        SQInteger creations = 0; ///< VMs created and set up
+        SQInteger resets = 0;    ///< VMs reset to the baseline and returned to the pool
+        SQInteger closed = 0;    ///< VMs closed (pool full, discarded or pool destroyed)
+    };
+
+    /// VM borrowed from the pool, returned (and reset) when the lease is destroyed
+    class Lease {
+    public:
+        Lease() : pool(nullptr) {}
+        Lease(Lease&& other) : pool(other.pool), entry(other.entry) {
+            other.pool = nullptr;
+        }
+        Lease& operator=(Lease&& other) {
+            if (this != &other) {
+                Release();
+                pool = other.pool;
+                entry = other.entry;
+                other.pool = nullptr;
+            }
+            return *this;
+        }
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        ~Lease() {
+            Release();
+        }
+
+        bool IsValid() const { return pool != nullptr; }
+        HSQUIRRELVM GetVM() const { return pool ? entry.vm : nullptr; }
+        operator HSQUIRRELVM() const { return GetVM(); }
+
+        /// Resets the VM and returns it to the pool
+        void Release() {
+            if (pool) {
+                pool->Return(entry, true);
+                pool = nullptr;
+            }
+        }
+
+        /// Closes the VM instead of returning it (e.g. when a script left it in an unusable state)
+        void Discard() {
+            if (pool) {
+                pool->Return(entry, false);
+                pool = nullptr;
+            }
+        }
+
+    private:
+        friend class VMPool;
+
+        struct Entry {
+            HSQUIRRELVM vm = nullptr;
+            HSQOBJECT root;     ///< Baseline clone of the root table
+            HSQOBJECT consts;   ///< Baseline clone of the const table
+        };
+
+        Lease(VMPool* p, const Entry& e) : pool(p), entry(e) {}
+
+        VMPool* pool;
+        Entry entry;
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Creates an empty pool
+    ///
+    /// \param setup     Function binding everything a fresh VM needs
+    /// \param maxIdle   Maximum number of idle VMs kept, VMs released beyond that are closed
+    /// \param stackSize Initial stack size of the VMs
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    explicit VMPool(const SetupFunc& setup, size_t maxIdle = 16, SQInteger stackSize = 1024)
+        : setupFunc(setup), maxIdleCount(maxIdle), vmStackSize(stackSize) {}
+
+    VMPool(const VMPool&) = delete;
+    VMPool& operator=(const VMPool&) = delete;
+
+    ~VMPool() {
+        for (Lease::Entry& e : idle)
+            Close(e);
+    }
+
+    /// Creates VMs until count of them are idle (bounded by maxIdle)
+    void Prewarm(size_t count) {
+        if (count > maxIdleCount)
+            count = maxIdleCount;
+        for (;;) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (idle.size() >= count)
+                    return;
+            }
+            Lease::Entry e = Create();
+            std::lock_guard<std::mutex> lock(mutex);
+            idle.push_back(e);
+        }
+    }
+
+    /// Takes an idle VM, or creates one if there is none
+    Lease Acquire() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!idle.empty()) {
+                Lease::Entry e = idle.back();
+                idle.pop_back();
+                ++stats.hits;
+                return Lease(this, e);
+            }
+        }
+        return Lease(this, Create());
+    }
+
+    size_t GetIdleCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return idle.size();
+    }
+
+    Stats GetStats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+private:
+    Lease::Entry Create() {
+        Lease::Entry e;
+        e.vm = sq_open(vmStackSize);
+        if (setupFunc)
+            setupFunc(e.vm);
+        sq_settop(e.vm, 0);
+        Snapshot(e.vm, e.root, &sq_pushroottable);
+        Snapshot(e.vm, e.consts, &sq_pushconsttable);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        ++stats.creations;
+        return e;
+    }
+
+    static void Snapshot(HSQUIRRELVM vm, HSQOBJECT& baseline, void (*pushTable)(HSQUIRRELVM)) {
+        pushTable(vm);
+        SQRAT_VERIFY(SQ_SUCCEEDED(sq_clone(vm, -1)));
+        sq_getstackobj(vm, -1, &baseline);
+        sq_addref(vm, &baseline);
+        sq_pop(vm, 2); // pop clone and table
+    }
+
+    // Replaces the slots of the live table with the slots of the baseline
+    static void Restore(HSQUIRRELVM vm, HSQOBJECT& baseline, void (*pushTable)(HSQUIRRELVM)) {
+        pushTable(vm);
+        SQRAT_VERIFY(SQ_SUCCEEDED(sq_clear(vm, -1)));
+        sq_pushobject(vm, baseline);
+        sq_pushnull(vm);
+        while (SQ_SUCCEEDED(sq_next(vm, -2))) {
+            SQRAT_VERIFY(SQ_SUCCEEDED(sq_newslot(vm, -5, SQFalse)));
+        }
+        sq_pop(vm, 3); // pop iterator, baseline and table
+    }
+
+    void Return(Lease::Entry& e, bool reuse) {
+        if (reuse) {
+            sq_settop(e.vm, 0);
+            Restore(e.vm, e.root, &sq_pushroottable);
+            Restore(e.vm, e.consts, &sq_pushconsttable);
+            sq_collectgarbage(e.vm);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            ++stats.resets;
+            if (idle.size() < maxIdleCount) {
+                idle.push_back(e);
+                return;
+            }
+        }
+        Close(e);
+    }
+
+    void Close(Lease::Entry& e) {
+        sq_release(e.vm, &e.root);
+        sq_release(e.vm, &e.consts);
+        sq_close(e.vm);
+        std::lock_guard<std::mutex> lock(mutex);
+        ++stats.closed;
+    }
+
+    SetupFunc setupFunc;
+    size_t maxIdleCount;
+    SQInteger vmStackSize;
+    mutable std::mutex mutex;
+    SQRAT_STD::vector<Lease::Entry> idle;
+    Stats stats;
+};
+
+}
+
+#endif
@@ -0,0 +1,342 @@
+// Sqrat: altered version by Gaijin Entertainment Corp.
+// sqratWorkerPool: VMs running script jobs on worker threads
+//
+
+//
+// Copyright (c) 2009 Brandon Jones
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not
+//  claim that you wrote the original software. If you use this software
+//  in a product, an acknowledgment in the product documentation would be
+//  appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be
+//  misrepresented as being the original software.
+//
+//  3. This notice may not be removed or altered from any source
+//  distribution.
+//
+
+
+
+#pragma once
+#if !defined(_SQRAT_WORKER_POOL_H_)
+#define _SQRAT_WORKER_POOL_H_
+
+#include <squirrel.h>
+
+#include "sqratFunction.h"
+#include "sqratTable.h"
+#include "sqratUtil.h"
+
+#if defined(SQRAT_HAS_EASTL)
+# include <EASTL/functional.h>
+# include <EASTL/tuple.h>
+# include <EASTL/vector.h>
+#else
+# include <functional>
+# include <tuple>
+# include <vector>
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace Sqrat {
+
+/// Outcome of a script function run by VMWorkerPool::Submit()
+template<class R>
+struct WorkResult {
+    bool succeeded = false;
+    R value = R();
+    string errMsg; ///< Error of a failed call
+};
+
+template<>
+struct WorkResult<void> {
+    bool succeeded = false;
+    string errMsg;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Threads, each owning a VM, running jobs in parallel
+///
+/// \remarks
+/// Every worker creates its VM with sq_open on its own thread and prepares it with the setup function (typically
+/// applying a BindingPlan and loading scripts), so all VMs expose the same bindings. A VM is only ever used by its
+/// worker thread.
+///
+/// Jobs are distributed round robin to per-worker queues; idle workers steal from the others. Jobs submitted to a
+/// specific worker are never stolen, so stateful work can stay with the VM holding its state. Arguments and results
+/// cross threads, so they must be plain C++ values (no Objects or Functions of another VM).
+///
+/// The destructor runs the jobs still queued before stopping the workers.
+///
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class VMWorkerPool {
+public:
+    typedef SQRAT_STD::function<void(HSQUIRRELVM)> SetupFunc;
+
+    /// Passed as a worker index to let any worker run the job
+    static const size_t AnyWorker = size_t(-1);
+
+    struct Stats {
+        SQInteger executed = 0; ///< Jobs run
+        SQInteger stolen = 0;   ///< Jobs taken from the queue of another worker
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Starts the workers
+    ///
+    /// \param workers   Number of workers (0 uses the number of hardware threads)
+    /// \param setup     Function preparing the VM of each worker, run on the worker thread
+    /// \param stackSize Initial stack size of the VMs
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    explicit VMWorkerPool(unsigned workers = 0, const SetupFunc& setup = nullptr, SQInteger stackSize = 1024)
+        : setupFunc(setup), vmStackSize(stackSize) {
+        if (workers == 0)
+            workers = std::thread::hardware_concurrency();
+        if (workers == 0)
+            workers = 1;
+        for (unsigned i = 0; i < workers; ++i)
+            pool.push_back(SQRAT_STD::shared_ptr<Worker>(new Worker()));
+        for (unsigned i = 0; i < workers; ++i)
+            pool[i]->thread = std::thread(&VMWorkerPool::WorkerMain, this, size_t(i));
+    }
+
+    VMWorkerPool(const VMWorkerPool&) = delete;
+    VMWorkerPool& operator=(const VMWorkerPool&) = delete;
+
+    ~VMWorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (SQRAT_STD::shared_ptr<Worker>& w : pool)
+            w->thread.join();
+    }
+
+    size_t GetWorkerCount() const { return pool.size(); }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Runs a callable with the VM of a worker
+    ///
+    /// \param func   Callable taking the HSQUIRRELVM of the worker
+    /// \param worker Index of the worker that must run the job, or AnyWorker
+    ///
+    /// \return Future receiving the value returned by func
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    template<class F>
+    std::future<decltype(SQRAT_STD::declval<F&>()(HSQUIRRELVM()))> Run(F func, size_t worker = AnyWorker) {
+        typedef decltype(SQRAT_STD::declval<F&>()(HSQUIRRELVM())) R;
+        SQRAT_STD::shared_ptr<std::packaged_task<R(HSQUIRRELVM)> > task(new std::packaged_task<R(HSQUIRRELVM)>(SQRAT_STD::move(func)));
+        std::future<R> future = task->get_future();
+        Enqueue([task](HSQUIRRELVM vm) { (*task)(vm); }, worker);
+        return future;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// Calls a function of the root table on any worker
+    ///
+    /// \param functionName Name of the function in the root table of the worker VMs
+    /// \param args         Arguments, copied to the worker
+    ///
+    /// \tparam R Return type (void to ignore the result)
+    ///
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    template<class R, class... Args>
+    std::future<WorkResult<R> > Submit(const SQChar* functionName, const Args&... args) {
+        return SubmitTo<R>(AnyWorker, functionName, args...);
+    }
+
+    /// Calls a function of the root table on the given worker (or AnyWorker)
+    template<class R, class... Args>
+    std::future<WorkResult<R> > SubmitTo(size_t worker, const SQChar* functionName, const Args&... args) {
+        string name(functionName);
+        SQRAT_STD::tuple<Args...> packed(args...);
+        return Run([name, packed](HSQUIRRELVM vm) {
+            return CallFunction<R>(vm, name, packed, SQRAT_STD::index_sequence_for<Args...>());
+        }, worker);
+    }
+
+    /// Blocks until every submitted job has run
+    void WaitIdle() {
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        idle.wait(lock, [this]() { return pending == 0; });
+    }
+
+    Stats GetStats() const {
+        Stats s;
+        for (const SQRAT_STD::shared_ptr<Worker>& w : pool) {
+            s.executed += w->executed.load(std::memory_order_relaxed);
+            s.stolen += w->stolen.load(std::memory_order_relaxed);
+        }
+        return s;
+    }
+
+private:
+    typedef SQRAT_STD::function<void(HSQUIRRELVM)> Job;
+
+    struct Worker {
+        std::thread thread;
+        std::mutex mutex;
+        std::deque<Job> shared; ///< May be stolen by other workers
+        std::deque<Job> pinned; ///< Only run by this worker
+        std::atomic<size_t> pinnedCount{0};
+        std::atomic<SQInteger> executed{0};
+        std::atomic<SQInteger> stolen{0};
+    };
+
+    template<class R, class Tuple, size_t... I>
+    static WorkResult<R> CallFunction(HSQUIRRELVM vm, const string& name, const Tuple& args, SQRAT_STD::index_sequence<I...>) {
+        WorkResult<R> r;
+        Function f = RootTable(vm).GetFunction(name.c_str());
+        if (f.IsNull()) {
+            r.errMsg = string(_SC("function not found: ")) + name;
+            return r;
+        }
+        r.succeeded = Invoke(f, r, SQRAT_STD::get<I>(args)...);
+        if (!r.succeeded)
+            r.errMsg = LastErrorString(vm);
+        return r;
+    }
+
+    template<class R, class... Args>
+    static bool Invoke(const Function& f, WorkResult<R>& r, const Args&... args) {
+        return f.Evaluate(args..., r.value);
+    }
+
+    template<class... Args>
+    static bool Invoke(const Function& f, WorkResult<void>&, const Args&... args) {
+        return f.Execute(args...);
+    }
+
+    void Enqueue(Job&& job, size_t worker) {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            ++pending;
+        }
+        if (worker != AnyWorker) {
+            SQRAT_ASSERT(worker < pool.size());
+            Worker& w = *pool[worker];
+            {
+                std::lock_guard<std::mutex> lock(w.mutex);
+                w.pinned.push_back(SQRAT_STD::move(job));
+            }
+            w.pinnedCount.fetch_add(1, std::memory_order_release);
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex); // a worker is either before its predicate check or waiting
+            }
+            wake.notify_all(); // only the owner can take it
+        } else {
+            Worker& w = *pool[nextWorker.fetch_add(1, std::memory_order_relaxed) % pool.size()];
+            {
+                std::lock_guard<std::mutex> lock(w.mutex);
+                w.shared.push_back(SQRAT_STD::move(job));
+            }
+            sharedCount.fetch_add(1, std::memory_order_release);
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex); // a worker is either before its predicate check or waiting
+            }
+            wake.notify_one();
+        }
+    }
+
+    bool TakeOwn(Worker& w, Job& job) {
+        std::lock_guard<std::mutex> lock(w.mutex);
+        if (!w.pinned.empty()) {
+            job = SQRAT_STD::move(w.pinned.front());
+            w.pinned.pop_front();
+            w.pinnedCount.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        if (!w.shared.empty()) {
+            job = SQRAT_STD::move(w.shared.front());
+            w.shared.pop_front();
+            sharedCount.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    // Takes the most recently queued job of another worker, skipping workers whose queue is busy
+    bool Steal(size_t self, Job& job) {
+        for (size_t i = 1; i < pool.size(); ++i) {
+            Worker& victim = *pool[(self + i) % pool.size()];
+            std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+            if (!lock.owns_lock() || victim.shared.empty())
+                continue;
+            job = SQRAT_STD::move(victim.shared.back());
+            victim.shared.pop_back();
+            sharedCount.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    void WorkerMain(size_t index) {
+        Worker& w = *pool[index];
+        HSQUIRRELVM vm = sq_open(vmStackSize);
+        if (setupFunc)
+            setupFunc(vm);
+
+        for (;;) {
+            Job job;
+            bool stole = false;
+            if (!TakeOwn(w, job))
+                stole = Steal(index, job);
+            if (job) {
+                job(vm);
+                job = nullptr;
+                w.executed.fetch_add(1, std::memory_order_relaxed);
+                if (stole)
+                    w.stolen.fetch_add(1, std::memory_order_relaxed);
+
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                if (--pending == 0)
+                    idle.notify_all();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this, &w]() {
+                return stopping || sharedCount.load(std::memory_order_acquire) > 0 || w.pinnedCount.load(std::memory_order_acquire) > 0;
+            });
+            if (stopping && sharedCount.load(std::memory_order_acquire) == 0 && w.pinnedCount.load(std::memory_order_acquire) == 0)
+                break;
+        }
+
+        sq_close(vm);
+    }
+
+    SetupFunc setupFunc;
+    SQInteger vmStackSize;
+    SQRAT_STD::vector<SQRAT_STD::shared_ptr<Worker> > pool;
+    std::atomic<size_t> nextWorker{0};
+    std::atomic<size_t> sharedCount{0}; ///< Jobs in the shared queues of all workers
+
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    size_t pending = 0; ///< Jobs submitted and not finished, guarded by sleepMutex
+    bool stopping = false;
+};
+
+}
+
+#endif